@@ -0,0 +1,211 @@
+"""
+ This file is part of StructInt.
+
+ StructInt is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ StructInt is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with StructInt.  If not, see <http://www.gnu.org/licenses/>.
+"""
+
+# Benchmark suite and regression harness for structint.
+#
+#   python benchmarks/bench_structint.py -o results.json
+#   python benchmarks/bench_structint.py --save-baseline benchmarks/baseline.json
+#   python benchmarks/bench_structint.py --baseline benchmarks/baseline.json --threshold 0.10
+#
+# Every case reports the best time of one operation in seconds. With --baseline, cases
+# which are slower than baseline by more than threshold are listed and the exit code is 1.
+# Baselines are machine specific, save them on the machine which runs the comparison.
+# Cases named "int/..." and "gmpy2/..." do the same work on python int and gmpy2.mpz
+# (if installed) for reference, they are never compared against baseline.
+
+import argparse
+import json
+import platform
+import random
+import sys
+import timeit
+
+import structint
+
+try:
+  import gmpy2
+except ImportError:
+  gmpy2 = None
+
+WIDTHS = [1, 63, 64, 65, 123, 256, 4096, 65536]
+FLAGS = {
+  "signed": 0,
+  "unsigned": structint.UNSIGNED,
+  "asym": structint.ASYMMETRIC_LEN,
+  "unsigned_asym": structint.UNSIGNED | structint.ASYMMETRIC_LEN,
+}
+INPUT_TYPES = ["int", "bytes", "bytearray", "bool", "none", "structint"]
+BATCH_COUNT = 1000
+EXPR_SOURCE = "(a & m) ^ (b >> 3) | c"
+
+
+def make_input(input_type, width, flags, rnd):
+  value = rnd.getrandbits(width)
+  byte_len = (width + 7) // 8
+  if input_type == "int":
+    return value
+  elif input_type == "bytes":
+    return value.to_bytes(byte_len, "big")
+  elif input_type == "bytearray":
+    return bytearray(value.to_bytes(byte_len, "big"))
+  elif input_type == "bool":
+    return bool(value & 1)
+  elif input_type == "none":
+    return None
+  else:
+    return structint.structint(value, width, flags)
+
+
+def cases(rnd):
+  """yields (name, callable, is_reference)"""
+  si = structint.structint
+  for width in WIDTHS:
+    mask = (1 << width) - 1
+
+    # conversion of every input type through structint_init
+    for flags_name, flags in FLAGS.items():
+      for input_type in INPUT_TYPES:
+        src = make_input(input_type, width, flags, rnd)
+        yield (f"init/{input_type}/{flags_name}/{width}", 
+          lambda src=src, width=width, flags=flags: si(src, width, flags), False)
+
+    src = rnd.getrandbits(width)
+    yield (f"int/init/{width}", lambda src=src, mask=mask: src & mask, True)
+    if gmpy2 is not None:
+      yield (f"gmpy2/init/{width}", lambda src=src, mask=gmpy2.mpz(mask): gmpy2.mpz(src) & mask, True)
+
+    # batch constructors, time is per call of BATCH_COUNT values
+    ints = [rnd.getrandbits(width) for _ in range(BATCH_COUNT)]
+    buf = b"".join(v.to_bytes((width + 7) // 8, "big") for v in ints)
+    yield (f"batch/from_ints/{width}", 
+      lambda ints=ints, width=width: structint.from_ints(ints, len=width), False)
+    yield (f"batch/from_buffer_many/{width}", 
+      lambda buf=buf, width=width: structint.from_buffer_many(buf, len=width), False)
+    yield (f"batch/init_loop/{width}", 
+      lambda ints=ints, width=width: [si(v, width) for v in ints], False)
+
+    # batch values get one shared block instead of the arena buffer
+    def arena_from_ints(ints=ints, width=width):
+      with structint.arena():
+        return structint.from_ints(ints, len=width)
+    yield (f"batch/from_ints_arena/{width}", arena_from_ints, False)
+
+    # bitwise
+    expr = structint.expr(EXPR_SOURCE)
+    values = {n: rnd.getrandbits(width) for n in expr.operands}
+    operands = {n: si(v, width, structint.UNSIGNED) for n, v in values.items()}
+    yield (f"bitwise/expr/{width}", lambda expr=expr, operands=operands: expr(**operands), False)
+    yield (f"int/bitwise/{width}", 
+      lambda v=values, mask=mask: (((v["a"] & v["m"]) ^ (v["b"] >> 3)) | v["c"]) & mask, True)
+    if gmpy2 is not None:
+      mv = {n: gmpy2.mpz(v) for n, v in values.items()}
+      yield (f"gmpy2/bitwise/{width}", 
+        lambda v=mv, mask=gmpy2.mpz(mask): (((v["a"] & v["m"]) ^ (v["b"] >> 3)) | v["c"]) & mask, True)
+
+
+def measure(func, repeat, min_time):
+  timer = timeit.Timer(func)
+  number = 1
+  while True:
+    elapsed = timer.timeit(number)
+    if elapsed >= min_time:
+      break
+
+    number *= 2 if elapsed <= 0 else max(2, int(min_time / elapsed) + 1)
+
+  best = min([elapsed] + timer.repeat(repeat - 1, number))
+  return best / number
+
+
+def compare(results, baseline, threshold):
+  regressions = []
+  for name, time in sorted(results.items()):
+    base = baseline.get(name)
+    if base is None or base <= 0:
+      continue
+
+    ratio = time / base
+    if ratio > 1.0 + threshold:
+      regressions.append((name, base, time, ratio))
+
+  return regressions
+
+
+def main():
+  parser = argparse.ArgumentParser(description="structint benchmarks")
+  parser.add_argument("-o", "--output", help="write results as json to file instead of stdout")
+  parser.add_argument("-k", "--filter", default="", help="run only cases which contain this string")
+  parser.add_argument("--repeat", type=int, default=5)
+  parser.add_argument("--min-time", type=float, default=0.05, help="minimal time of one repeat in seconds")
+  parser.add_argument("--seed", type=int, default=0)
+  parser.add_argument("--baseline", help="json results to compare with")
+  parser.add_argument("--threshold", type=float, default=0.10, help="allowed slowdown against baseline")
+  parser.add_argument("--save-baseline", help="write results as new baseline file")
+  args = parser.parse_args()
+
+  rnd = random.Random(args.seed)
+  results = {}
+  references = set()
+  for name, func, is_reference in cases(rnd):
+    if args.filter not in name:
+      continue
+
+    results[name] = measure(func, args.repeat, args.min_time)
+    if is_reference:
+      references.add(name)
+
+    print(f"{name:48} {results[name] * 1e9:14.1f} ns", file=sys.stderr)
+
+  report = {
+    "meta": {
+      "python": sys.version,
+      "platform": platform.platform(),
+      "machine": platform.machine(),
+      "gmpy2": None if gmpy2 is None else gmpy2.version(),
+      "seed": args.seed,
+    },
+    "results": results,
+  }
+
+  text = json.dumps(report, indent=2, sort_keys=True)
+  if args.output:
+    with open(args.output, "w") as f:
+      f.write(text + "\n")
+  else:
+    print(text)
+
+  if args.save_baseline:
+    with open(args.save_baseline, "w") as f:
+      f.write(text + "\n")
+
+  if args.baseline:
+    with open(args.baseline) as f:
+      baseline = json.load(f)["results"]
+
+    own = {n: t for n, t in results.items() if n not in references}
+    regressions = compare(own, baseline, args.threshold)
+    for name, base, time, ratio in regressions:
+      print(f"REGRESSION {name}: {base * 1e9:.1f} ns -> {time * 1e9:.1f} ns ({ratio:.2f}x)", file=sys.stderr)
+
+    if regressions:
+      print(f"{len(regressions)} case(s) slower than baseline by more than {args.threshold:.0%}", file=sys.stderr)
+      return 1
+
+  return 0
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -0,0 +1,169 @@
+"""
+ This file is part of StructInt.
+
+ StructInt is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ StructInt is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with StructInt.  If not, see <http://www.gnu.org/licenses/>.
+"""
+
+# Correctness check of structint.expr against fixed width python int arithmetic.
+#
+#   python benchmarks/check_expr.py
+#   python benchmarks/check_expr.py --random 5000 --seed 3
+#
+# Every formula is evaluated for every width, signed and unsigned, with random operands.
+# Mismatches are printed and the exit code is 1.
+
+import argparse
+import random
+import sys
+
+import structint
+
+WIDTHS = [1, 63, 64, 65, 129, 4096]
+FLAGS = {
+  "signed": 0,
+  "unsigned": structint.UNSIGNED,
+}
+FORMULAS = [
+  "a",
+  "~a",
+  "(a & m) ^ (b >> 3) | c",
+  "(a << 3) >> 3",
+  "a << 70 >> 70",
+  "a >> 70 << 70",
+  "a >> 1 << 1 >> 1 << 1",
+  "a << 1 << 1 << 1 >> 2 >> 1",
+  "a >> 63 >> 1 >> 1",
+  "a << 64 << 64 >> 129",
+  "~(a | b) & (c >> 64)",
+  "~(a | b) & (c << 130) ^ m >> 1",
+  "(a >> 5) ^ (a << 5) ^ (a >> 200)",
+  "~(~a >> 65) << 65",
+  "a ^ a",
+  "a >> 0 << 0",
+  "((a)) << 4095",
+  "a >> 4097",
+]
+SHIFTS = [0, 1, 3, 63, 64, 65, 127, 128, 130, 200, 513, 1000, 4095, 4096, 5000]
+
+
+def normalize(value, width, unsigned):
+  value &= (1 << width) - 1
+  if not unsigned and (value >> (width - 1)):
+    value -= 1 << width
+  return value
+
+
+class Reference:
+  """python int which keeps the width and sign of structint after every operation"""
+  def __init__(self, value, width, unsigned):
+    self.width = width
+    self.unsigned = unsigned
+    self.value = normalize(value, width, unsigned)
+
+  def new(self, value):
+    return Reference(value, self.width, self.unsigned)
+
+  def __and__(self, other):
+    return self.new(self.value & other.value)
+
+  def __or__(self, other):
+    return self.new(self.value | other.value)
+
+  def __xor__(self, other):
+    return self.new(self.value ^ other.value)
+
+  def __invert__(self):
+    return self.new(~self.value)
+
+  def __lshift__(self, count):
+    return self.new(self.value << count)
+
+  def __rshift__(self, count):
+    return self.new(self.value >> count)
+
+
+def reference(source, operands, width, unsigned):
+  env = {name: Reference(value, width, unsigned) for name, value in operands.items()}
+  return eval(source, {"__builtins__": {}}, env).value
+
+
+def value_of(obj):
+  """reads the value of structint from dumps(): 16 bytes header, then uint64 parts"""
+  data = structint.dumps(obj)
+  order = "big" if data[3] & 0x80 else "little"
+  parts = data[16:]
+  return sum(int.from_bytes(parts[i:i + 8], order) << (8 * i) for i in range(0, len(parts), 8))
+
+
+def random_formula(rnd, depth, names):
+  if (depth == 0) or (rnd.random() < 0.2):
+    return rnd.choice(names)
+
+  k = rnd.random()
+  if k < 0.15:
+    return "~(" + random_formula(rnd, depth - 1, names) + ")"
+  if k < 0.5:
+    shift = rnd.choice(SHIFTS)
+    return "(" + random_formula(rnd, depth - 1, names) + ")" + rnd.choice([">>", "<<"]) + str(shift)
+
+  op = rnd.choice("&^|")
+  return "(" + random_formula(rnd, depth - 1, names) + ")" + op + "(" + random_formula(rnd, depth - 1, names) + ")"
+
+
+def check(source, width, flags_name, rnd):
+  """returns None or description of mismatch"""
+  flags = FLAGS[flags_name]
+  unsigned = flags_name == "unsigned"
+  e = structint.expr(source)
+  operands = {name: normalize(rnd.getrandbits(width), width, unsigned) for name in e.operands}
+  args = {name: structint.structint(value, width, flags) for name, value in operands.items()}
+
+  got = normalize(value_of(e(**args)), width, unsigned)
+  expected = reference(source, operands, width, unsigned)
+  if got == expected:
+    return None
+
+  return f"{source!r} width={width} {flags_name} operands={operands}: got {got:#x}, expected {expected:#x}"
+
+
+def main():
+  parser = argparse.ArgumentParser(description="structint.expr correctness check")
+  parser.add_argument("--random", type=int, default=2000, help="number of random formulas")
+  parser.add_argument("--depth", type=int, default=6, help="maximal depth of random formulas")
+  parser.add_argument("--seed", type=int, default=0)
+  args = parser.parse_args()
+
+  rnd = random.Random(args.seed)
+  sources = list(FORMULAS)
+  for _ in range(args.random):
+    sources.append(random_formula(rnd, rnd.randrange(1, args.depth + 1), ["a", "b", "c"]))
+
+  checked = 0
+  mismatches = []
+  for source in sources:
+    for width in WIDTHS:
+      for flags_name in FLAGS:
+        mismatch = check(source, width, flags_name, rnd)
+        checked += 1
+        if mismatch is not None:
+          mismatches.append(mismatch)
+
+  for mismatch in mismatches:
+    print("MISMATCH " + mismatch, file=sys.stderr)
+
+  print(f"{checked} checks, {len(mismatches)} mismatches")
+  return 1 if mismatches else 0
+
+if __name__ == "__main__":
+  sys.exit(main())
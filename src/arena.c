@@ -0,0 +1,291 @@
+/*
+ * This file is part of StructInt.
+ *
+ * StructInt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * StructInt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with StructInt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "arena.h"
+
+#include <string.h>
+
+#ifdef Py_GIL_DISABLED
+#define arena_lock(arena) PyMutex_Lock(&(arena)->mutex)
+#define arena_unlock(arena) PyMutex_Unlock(&(arena)->mutex)
+#else
+#define arena_lock(arena)
+#define arena_unlock(arena)
+#endif
+
+#define arena_get_obj(ptr) ((PyObject*)((uint8_t*)(ptr) - offsetof(structint_arena_obj_t, arena)))
+
+// active arenas of all interpreters running on this thread, innermost first
+static STRUCTINT_THREAD_LOCAL structint_arena_t *thread_arenas = NULL;
+
+structint_arena_t *structint_arena_current(void) {
+  if (thread_arenas == NULL) {
+    return NULL;
+  }
+
+  PyThreadState *tstate = PyThreadState_Get();
+  for (structint_arena_t *arena = thread_arenas; arena != NULL; arena = arena->prev) {
+    if (arena->tstate == tstate) {
+      return arena;
+    }
+  }
+
+  return NULL;
+}
+
+uint64_t *structint_arena_alloc(structint_arena_t *arena, size_t sz) {
+  // only the owner allocates, so promotion never runs in the middle of an allocation
+  if (arena->tstate != PyThreadState_Get()) {
+    return NULL;
+  }
+
+  uint64_t *res = NULL;
+  sz = round_size(sz, STRUCTINT_ARENA_ALIGN);
+
+  arena_lock(arena);
+  if ((arena->block != NULL) && (sz <= arena->size - arena->used)) {
+    res = (uint64_t*)(arena->begin + arena->used);
+    arena->used += sz;
+  }
+  arena_unlock(arena);
+
+  return res;
+}
+
+bool structint_arena_owns(structint_arena_t *arena, uint64_t *value) {
+  uint8_t *ptr = (uint8_t*)value;
+  return (arena->block != NULL) && (ptr >= arena->begin) && (ptr < arena->begin + arena->size);
+}
+
+void structint_arena_link(structint_arena_t *arena, structint_t *self) {
+  arena_lock(arena);
+  self->arena = arena;
+  self->arena_prev = NULL;
+  self->arena_next = arena->objects;
+  if (arena->objects != NULL) {
+    arena->objects->arena_prev = self;
+  }
+
+  arena->objects = self;
+  arena_unlock(arena);
+  return;
+}
+
+static void arena_unlink_locked(structint_arena_t *arena, structint_t *self) {
+  if (self->arena_prev != NULL) {
+    self->arena_prev->arena_next = self->arena_next;
+  }
+  else {
+    arena->objects = self->arena_next;
+  }
+
+  if (self->arena_next != NULL) {
+    self->arena_next->arena_prev = self->arena_prev;
+  }
+
+  self->arena = NULL;
+  self->arena_prev = NULL;
+  self->arena_next = NULL;
+  return;
+}
+
+bool structint_arena_unlink(structint_t *self) {
+  // linked structint keeps the arena active, the reference keeps it alive while waiting for the mutex
+  PyObject *arena_obj = NULL;
+  Py_BEGIN_CRITICAL_SECTION(self);
+  if (self->arena != NULL) {
+    arena_obj = Py_NewRef(arena_get_obj(self->arena));
+  }
+  Py_END_CRITICAL_SECTION();
+
+  if (arena_obj == NULL) {
+    return false;
+  }
+
+  bool res = false;
+  structint_arena_t *arena = &((structint_arena_obj_t*)arena_obj)->arena;
+  arena_lock(arena);
+  // promotion in another thread could unlink it in the meantime
+  if (self->arena == arena) {
+    res = structint_arena_owns(arena, self->value);
+    arena_unlink_locked(arena, self);
+  }
+  arena_unlock(arena);
+
+  Py_DECREF(arena_obj);
+  return res;
+}
+
+/*
+ * Structints which escaped the with block get their own copy of value. If a copy can't 
+ * be allocated, the structint stays linked and the arena must keep its buffer.
+ * The arena mutex is held for the whole promotion, so dying structints wait in 
+ * structint_arena_unlink() and stay valid
+ */
+static int arena_promote_all(structint_arena_t *arena) {
+  int res = 0;
+
+  arena_lock(arena);
+  structint_t *self = arena->objects;
+  while (self != NULL) {
+    structint_t *next = self->arena_next;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    uint64_t *value = self->value;
+    if (structint_arena_owns(arena, self->value)) {
+      value = alloc_uint64list(NULL, NULL, self->byte_sz, 0LL, NULL);
+      if (value == NULL) {
+        res = -1;
+      }
+      else {
+        memcpy(value, self->value, self->byte_sz);
+        self->value = value;
+      }
+    }
+
+    if (value != NULL) {
+      arena_unlink_locked(arena, self);
+    }
+    Py_END_CRITICAL_SECTION();
+    self = next;
+  }
+  arena_unlock(arena);
+
+  if (res) {
+    PyErr_NoMemory();
+  }
+
+  return res;
+}
+
+
+static int arena_init(structint_arena_obj_t *self, PyObject *args, PyObject *kwds) {
+  static char *kwlist[] = {"size", NULL};
+  Py_ssize_t arg_sz = STRUCTINT_ARENA_DEFAULT_SZ;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|n", kwlist, &arg_sz) || (arg_sz <= 0)) {
+    PyErr_BadArgument();
+    return -1;
+  }
+
+  if (self->active) {
+    PyErr_SetString(PyExc_RuntimeError, ARENA_ACTIVE_ERROR_STR);
+    return -1;
+  }
+
+  self->arg_sz = arg_sz;
+  return 0;
+}
+
+static void arena_dealloc(structint_arena_obj_t *self) {
+  PyTypeObject *type = Py_TYPE(self);
+  if (self->arena.block != NULL) {
+    PyMem_RawFree(self->arena.block);
+  }
+
+  type->tp_free((PyObject*)self);
+  Py_DECREF(type);
+  return;
+}
+
+static PyObject *arena_enter(structint_arena_obj_t *self, PyObject *Py_UNUSED(ignored)) {
+  if (self->active) {
+    PyErr_SetString(PyExc_RuntimeError, ARENA_ACTIVE_ERROR_STR);
+    return NULL;
+  }
+
+  structint_arena_t *arena = &self->arena;
+  arena->block = PyMem_RawMalloc(self->arg_sz + STRUCTINT_ARENA_ALIGN);
+  if (arena->block == NULL) {
+    return PyErr_NoMemory();
+  }
+
+  arena->begin = (uint8_t*)round_size((uintptr_t)arena->block, STRUCTINT_ARENA_ALIGN);
+  arena->size = self->arg_sz;
+  arena->used = 0LL;
+  arena->objects = NULL;
+
+  arena->tstate = PyThreadState_Get();
+  arena->prev = thread_arenas;
+  thread_arenas = arena;
+  self->active = 1;
+
+  // thread's arena stack keeps the arena alive until __exit__
+  Py_INCREF(self);
+  return Py_NewRef(self);
+}
+
+static PyObject *arena_exit(structint_arena_obj_t *self, PyObject *Py_UNUSED(args)) {
+  structint_arena_t *arena = &self->arena;
+  if (!self->active || (structint_arena_current() != arena)) {
+    PyErr_SetString(PyExc_RuntimeError, ARENA_ORDER_ERROR_STR);
+    return NULL;
+  }
+
+  // arenas of other interpreters can be above it in the stack of this thread
+  structint_arena_t **link = &thread_arenas;
+  while (*link != arena) {
+    link = &(*link)->prev;
+  }
+
+  *link = arena->prev;
+  arena->prev = NULL;
+  arena->tstate = NULL;
+  if (arena_promote_all(arena)) {
+    // leave the buffer and the stack's reference to the structints which still use it
+    return NULL;
+  }
+
+  PyMem_RawFree(arena->block);
+  arena->block = NULL;
+  arena->begin = NULL;
+  arena->used = 0LL;
+  self->active = 0;
+
+  Py_DECREF(self);
+  Py_RETURN_FALSE;
+}
+
+
+static PyMemberDef arena_members[] = {
+  {"size", T_ULONGLONG, offsetof(structint_arena_obj_t, arg_sz), READONLY},
+  {"used", T_ULONGLONG, offsetof(structint_arena_obj_t, arena.used), READONLY},
+  {NULL}
+};
+
+static PyMethodDef arena_methods[] = {
+  {"__enter__", (PyCFunction)arena_enter, METH_NOARGS},
+  {"__exit__", (PyCFunction)arena_exit, METH_VARARGS},
+  {NULL}
+};
+
+static PyType_Slot arena_slots[] = {
+  {Py_tp_doc, PyDoc_STR(ARENA_DOCSTR)},
+  {Py_tp_new, PyType_GenericNew},
+  {Py_tp_init, arena_init},
+  {Py_tp_dealloc, arena_dealloc},
+  {Py_tp_members, arena_members},
+  {Py_tp_methods, arena_methods},
+  {0, NULL}
+};
+
+PyType_Spec structint_arena_spec = {
+  .name = "structint.arena",
+  .basicsize = sizeof(structint_arena_obj_t),
+  .itemsize = 0,
+  .flags = Py_TPFLAGS_DEFAULT,
+  .slots = arena_slots,
+};
@@ -0,0 +1,82 @@
+/*
+ * This file is part of StructInt.
+ *
+ * StructInt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * StructInt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with StructInt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "core.h"
+
+#define ARENA_DOCSTR "arena(size=1048576)\n\nwith block in which uint64lists of new structints are bump allocated from one buffer. Batch constructors keep their own shared block instead. Structints which are still alive at the end of the block get their own uint64list"
+
+#define STRUCTINT_ARENA_ALIGN STRUCTINT_VALUE_ALIGN
+#define STRUCTINT_ARENA_DEFAULT_SZ (1LL << 20)
+
+#define ARENA_ACTIVE_ERROR_STR "arena is already active"
+#define ARENA_ORDER_ERROR_STR "arena isn't the innermost active arena of this thread"
+
+#if defined(_MSC_VER)
+#define STRUCTINT_THREAD_LOCAL __declspec(thread)
+#else
+#define STRUCTINT_THREAD_LOCAL _Thread_local
+#endif
+
+/*
+ * Arena is a single STRUCTINT_VALUE_ALIGN aligned buffer. Allocation only moves 'used' forward, 
+ * memory is given back all at once when the with block ends.
+ * Active arenas of one OS thread make a stack (prev), which is shared by all interpreters 
+ * running on the thread. Every arena belongs to the thread state (tstate) which entered it, 
+ * so only structints created by this thread in this interpreter come from it, and only 
+ * this thread state allocates from it. These structints are linked in 'objects' until 
+ * they die or get promoted to their own uint64list.
+ * 'objects' and 'used' are guarded by 'mutex', while 'arena', 'value' and 'byte_sz' 
+ * of structints are guarded by their critical sections
+ */
+struct structint_arena_s {
+  uint8_t *block;
+  uint8_t *begin;
+  size_t size;
+  size_t used;
+
+  PyThreadState *tstate;
+  structint_arena_t *prev;
+  structint_t *objects;
+#ifdef Py_GIL_DISABLED
+  PyMutex mutex;
+#endif
+};
+
+typedef struct {
+  PyObject_HEAD
+
+  structint_arena_t arena;
+  size_t arg_sz;
+  char active;
+} structint_arena_obj_t;
+
+extern PyType_Spec structint_arena_spec;
+
+structint_arena_t *structint_arena_current(void);
+/*
+ * structint_arena_alloc() returns NULL without exception if the arena is full or 
+ * belongs to another thread, then the caller should fall back to PyMem_Raw* functions
+ */
+uint64_t *structint_arena_alloc(structint_arena_t *arena, size_t sz);
+bool structint_arena_owns(structint_arena_t *arena, uint64_t *value);
+void structint_arena_link(structint_arena_t *arena, structint_t *self);
+/*
+ * structint_arena_unlink() returns true if 'value' of 'self' is still in the arena buffer,
+ * then it must not be freed
+ */
+bool structint_arena_unlink(structint_t *self);
@@ -0,0 +1,294 @@
+/*
+ * This file is part of StructInt.
+ *
+ * StructInt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * StructInt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with StructInt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "batch.h"
+#include "stats.h"
+
+structint_t *batch_set_layout(structint_t *layout, size_t bit_len, uint32_t flags) {
+  layout->value = NULL;
+  layout->bit_len = bit_len;
+  layout->flags = flags;
+  layout->byte_sz = get_uint64list_bytesz_from_bitlen(bit_len);
+  layout->used_value_parts = get_uint64list_idx_by_bit(bit_len) + 1;
+  layout->sign_mask = (bit_len == 0) ? 0LL : get_signbit_mask(bit_len);
+
+  layout->asymmetric = 0;
+  layout->carry = 0;
+  layout->overflow = 0;
+  layout->null = (bit_len == 0);
+
+  return layout;
+}
+
+batch_block_t *batch_alloc_block(batch_block_t *block, structint_t *layout, size_t count) {
+  block->next = NULL;
+  block->byte_sz = 0LL;
+  block->left = count;
+  if (count == 0) {
+    return block;
+  }
+
+  block->next = alloc_uint64list_block(count, layout->byte_sz, &block->byte_sz);
+  if (block->next == NULL) {
+    return (batch_block_t*)PyErr_NoMemory();
+  }
+
+  return block;
+}
+
+void batch_dealloc_block(batch_block_t *block) {
+  dealloc_uint64list_block(block->next, block->left);
+  block->left = 0LL;
+  return;
+}
+
+structint_t *batch_new_structint(PyTypeObject *type, structint_t *layout, batch_block_t *block) {
+  structint_t *self = (structint_t*)structint_new(type, NULL, NULL);
+  if (self == NULL) {
+    return NULL;
+  }
+
+  if (block != NULL) {
+    self->value = block->next;
+    self->byte_sz = block->byte_sz;
+    block->next += get_uint64list_block_stride(block->byte_sz) / 8;
+    --block->left;
+  }
+  else {
+    self->value = alloc_uint64list(self->arena, NULL, layout->byte_sz, 0LL, &self->byte_sz);
+    if (self->value == NULL) {
+      Py_DECREF(self);
+      return (structint_t*)PyErr_NoMemory();
+    }
+  }
+
+  self->used_value_parts = layout->used_value_parts;
+  structint_unsafe_copy(self, layout);
+  return self;
+}
+
+
+PyObject *structint_from_ints(PyObject *module, PyObject *args, PyObject *kwds) {
+  static char *kwlist[] = {"iterable", "len", "flags", NULL};
+  PyObject *arg_iterable;
+  size_t arg_bit_len = 0;
+  uint32_t arg_flags = 0;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|KI", kwlist, 
+      &arg_iterable, &arg_bit_len, &arg_flags)) {
+    PyErr_BadArgument();
+    return NULL;
+  }
+
+  stats_op_begin();
+  structint_state *state = structint_get_module_state(module);
+  PyObject *seq = PySequence_Fast(arg_iterable, "first argument must be iterable");
+  if (seq == NULL) {
+    return NULL;
+  }
+
+  Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+  PyObject **items = PySequence_Fast_ITEMS(seq);
+
+  // without len, the longest value decides about layout
+  if (arg_bit_len == 0) {
+    for (Py_ssize_t i = 0; i < count; ++i) {
+      size_t bit_len = 0LL;
+      switch (check_valueobj_type(items[i])) {
+        case Long: {
+          bit_len = get_bitlen_pylong(items[i]);
+          if ((bit_len == 0) && PyErr_Occurred()) {
+            Py_DECREF(seq);
+            return NULL;
+          }
+
+          break;
+        }
+        case Bool: {
+          bit_len = 1LL;
+          break;
+        }
+        case None: {
+          break;
+        }
+        default: {
+          Py_DECREF(seq);
+          PyErr_SetString(PyExc_TypeError, TYPE_OBJ_ERROR_STR);
+          return NULL;
+        }
+      }
+
+      if (bit_len > arg_bit_len) {
+        arg_bit_len = bit_len;
+      }
+    }
+  }
+
+  structint_t layout;
+  batch_set_layout(&layout, arg_bit_len, arg_flags);
+
+  PyObject *res = PyList_New(count);
+  if (res == NULL) {
+    Py_DECREF(seq);
+    return NULL;
+  }
+
+  batch_block_t block;
+  if (batch_alloc_block(&block, &layout, count) == NULL) {
+    Py_DECREF(seq);
+    Py_DECREF(res);
+    return NULL;
+  }
+
+  for (Py_ssize_t i = 0; i < count; ++i) {
+    PyObject *src = items[i];
+    structint_obj_t src_type = check_valueobj_type(src);
+    if ((src_type != Long) && (src_type != Bool) && (src_type != None)) {
+      PyErr_SetString(PyExc_TypeError, TYPE_OBJ_ERROR_STR);
+      goto error;
+    }
+
+    structint_t *self = batch_new_structint(state->structint_Type, &layout, &block);
+    if (self == NULL) {
+      goto error;
+    }
+
+    PyList_SET_ITEM(res, i, (PyObject*)self);
+    if ((src_type == None) || (layout.bit_len == 0)) {
+      stats_converted(src_type, 0LL);
+      structint_set_null_value(self);
+      continue;
+    }
+
+    int err;
+    if (src_type == Long) {
+      err = convert_pylong_to_uint64list(self->value, layout.bit_len, src);
+    }
+    else {
+      err = convert_pybool_to_uint64list(self->value, layout.bit_len, src);
+    }
+
+    if (err) {
+      if (!PyErr_Occurred()) {
+        PyErr_SetString(PyExc_TypeError, INTERNAL_LIB_ERROR_STR);
+      }
+
+      goto error;
+    }
+
+    stats_converted(src_type, (src_type == Long) ? (get_bitlen_pylong(src) + 7) / 8 : 1LL);
+    structint_sign_smear(self);
+  }
+
+  Py_DECREF(seq);
+  stats_op_end(StatsOpFromInts, layout.used_value_parts);
+  return res;
+
+error:
+  batch_dealloc_block(&block);
+  Py_DECREF(seq);
+  Py_DECREF(res);
+  return NULL;
+}
+
+PyObject *structint_from_buffer_many(PyObject *module, PyObject *args, PyObject *kwds) {
+  static char *kwlist[] = {"buf", "len", "flags", "count", NULL};
+  PyObject *arg_buf;
+  size_t arg_bit_len = 0;
+  uint32_t arg_flags = 0;
+  Py_ssize_t arg_count = 0;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|KIn", kwlist, 
+      &arg_buf, &arg_bit_len, &arg_flags, &arg_count) || (arg_count < 0)) {
+    PyErr_BadArgument();
+    return NULL;
+  }
+
+  stats_op_begin();
+  structint_state *state = structint_get_module_state(module);
+  Py_buffer buf;
+  if (convert_pybyteslike_to_pybuffer(&buf, arg_buf) == NULL) {
+    PyErr_BadArgument();
+    return NULL;
+  }
+
+  // every value takes a whole number of bytes in buf
+  Py_ssize_t item_sz;
+  if (arg_bit_len != 0) {
+    item_sz = (arg_bit_len + 7) / 8;
+  }
+  else if (arg_count != 0) {
+    item_sz = buf.len / arg_count;
+    arg_bit_len = item_sz * 8;
+  }
+  else {
+    PyBuffer_Release(&buf);
+    PyErr_SetString(PyExc_ValueError, BATCH_LAYOUT_ERROR_STR);
+    return NULL;
+  }
+
+  Py_ssize_t count = arg_count;
+  if ((count == 0) && (item_sz != 0)) {
+    count = buf.len / item_sz;
+  }
+
+  // count * item_sz can overflow, so it's compared by division
+  if ((item_sz == 0) || (count > buf.len / item_sz) || 
+      ((arg_count == 0) && (count * item_sz != buf.len))) {
+    PyErr_Format(PyExc_ValueError, BATCH_BUFFER_SZ_ERROR_FMT, buf.len, count, item_sz);
+    PyBuffer_Release(&buf);
+    return NULL;
+  }
+
+  structint_t layout;
+  batch_set_layout(&layout, arg_bit_len, arg_flags);
+
+  PyObject *res = PyList_New(count);
+  if (res == NULL) {
+    PyBuffer_Release(&buf);
+    return NULL;
+  }
+
+  batch_block_t block;
+  if (batch_alloc_block(&block, &layout, count) == NULL) {
+    PyBuffer_Release(&buf);
+    Py_DECREF(res);
+    return NULL;
+  }
+
+  Py_buffer item = buf;
+  item.len = item_sz;
+  for (Py_ssize_t i = 0; i < count; ++i) {
+    structint_t *self = batch_new_structint(state->structint_Type, &layout, &block);
+    if (self == NULL) {
+      batch_dealloc_block(&block);
+      PyBuffer_Release(&buf);
+      Py_DECREF(res);
+      return NULL;
+    }
+
+    PyList_SET_ITEM(res, i, (PyObject*)self);
+    item.buf = (uint8_t*)buf.buf + (i * item_sz);
+    convert_pybuffer_to_uint64list(self->value, layout.bit_len, &item);
+    stats_converted(check_valueobj_type(arg_buf), item_sz);
+    structint_sign_smear(self);
+  }
+
+  PyBuffer_Release(&buf);
+  stats_op_end(StatsOpFromBufferMany, layout.used_value_parts);
+  return res;
+}
@@ -0,0 +1,50 @@
+/*
+ * This file is part of StructInt.
+ *
+ * StructInt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * StructInt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with StructInt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "core.h"
+
+#define FROM_INTS_DOCSTR "from_ints(iterable, len=0, flags=0)\n\nlist of structints with the same len and flags, one for every int, bool or None in iterable. If len is 0, the longest value decides"
+#define FROM_BUFFER_MANY_DOCSTR "from_buffer_many(buf, len=0, flags=0, count=0)\n\nlist of structints read from consecutive (len + 7) // 8 byte fields of buf. If len is 0, it is taken from count"
+
+#define BATCH_LAYOUT_ERROR_STR "len or count must be given"
+#define BATCH_BUFFER_SZ_ERROR_FMT "buffer has %zd bytes but it should hold %zd values of %zd bytes"
+
+/*
+ * Batch constructors check arguments and compute the layout (bit_len, byte_sz, 
+ * used_value_parts, sign_mask) once and allocate uint64lists of all values in one 
+ * shared block, then every value is only converted
+ */
+typedef struct {
+  uint64_t *next;  // next uint64list which wasn't given to any structint
+  size_t byte_sz;  // allocated size of every uint64list
+  size_t left;
+} batch_block_t;
+
+/*
+ * layout is a structint_t without value, all new objects copy their parameters from it.
+ * batch_new_structint() returns a structint of 'type' with allocated, but not filled value,
+ * which is taken from 'block' or allocated on its own if 'block' is NULL.
+ * batch_dealloc_block() releases uint64lists left in 'block' after an error
+ */
+structint_t *batch_set_layout(structint_t *layout, size_t bit_len, uint32_t flags);
+batch_block_t *batch_alloc_block(batch_block_t *block, structint_t *layout, size_t count);
+void batch_dealloc_block(batch_block_t *block);
+structint_t *batch_new_structint(PyTypeObject *type, structint_t *layout, batch_block_t *block);
+
+PyObject *structint_from_ints(PyObject *module, PyObject *args, PyObject *kwds);
+PyObject *structint_from_buffer_many(PyObject *module, PyObject *args, PyObject *kwds);
@@ -16,9 +16,98 @@
 */
 
 #include "core.h"
+#include "arena.h"
+#include "stats.h"
 
-uint64_t *alloc_uint64list(uint64_t *value, size_t new_sz, size_t old_sz, size_t *res_sz) {
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define block_atomic_sub(ptr, n) (_InterlockedExchangeAdd64((volatile __int64*)(ptr), -(__int64)(n)) - (__int64)(n))
+#else
+#define block_atomic_sub(ptr, n) __atomic_sub_fetch(ptr, n, __ATOMIC_ACQ_REL)
+#endif
+
+/*
+ * Shared block of alloc_uint64list_block(). refcnt counts uint64lists which weren't released yet
+ */
+typedef struct {
+  int64_t refcnt;
+} uint64list_block_t;
+
+#define UINT64LIST_BLOCK_TAG ((uintptr_t)1)
+
+/*
+ * PyMem_Raw* functions don't guarantee STRUCTINT_VALUE_ALIGN alignment, so the 
+ * allocated block is stored just before the aligned uint64list. Pointer to a shared 
+ * uint64list_block_t is tagged with UINT64LIST_BLOCK_TAG
+ */
+static uint64_t *raw_aligned_alloc(size_t sz) {
+  uint8_t *block = PyMem_RawMalloc(sz + STRUCTINT_VALUE_ALIGN + sizeof(void*));
+  if (block == NULL) {
+    return NULL;
+  }
+
+  uint8_t *aligned = (uint8_t*)round_size((uintptr_t)(block + sizeof(void*)), STRUCTINT_VALUE_ALIGN);
+  ((void**)aligned)[-1] = block;
+  return (uint64_t*)aligned;
+}
+
+static void raw_aligned_free(uint64_t *value) {
+  uintptr_t block = ((uintptr_t*)value)[-1];
+  if (block & UINT64LIST_BLOCK_TAG) {
+    uint64list_block_t *shared = (uint64list_block_t*)(block & ~UINT64LIST_BLOCK_TAG);
+    if (block_atomic_sub(&shared->refcnt, 1) == 0) {
+      PyMem_RawFree(shared);
+    }
+
+    return;
+  }
+
+  PyMem_RawFree((void*)block);
+  return;
+}
+
+uint64_t *alloc_uint64list_block(size_t count, size_t sz, size_t *res_sz) {
+  size_t alloc_sz = round_size(sz, STRUCTINT_VALUE_ALIGN);
+  size_t stride = get_uint64list_block_stride(alloc_sz);
+  size_t head_sz = sizeof(uint64list_block_t) + sizeof(void*) + STRUCTINT_VALUE_ALIGN;
+  if ((count == 0) || (count > (PY_SSIZE_T_MAX - head_sz) / stride)) {
+    return NULL;
+  }
+
+  uint64list_block_t *shared = PyMem_RawMalloc(head_sz + count * stride);
+  if (shared == NULL) {
+    return NULL;
+  }
+
+  stats_alloc(StatsAllocBlock, count * alloc_sz, 0LL);
+  shared->refcnt = count;
+  uint8_t *first = (uint8_t*)round_size((uintptr_t)(shared + 1) + sizeof(void*), STRUCTINT_VALUE_ALIGN);
+  for (size_t i = 0; i < count; ++i) {
+    ((uintptr_t*)(first + i * stride))[-1] = (uintptr_t)shared | UINT64LIST_BLOCK_TAG;
+  }
+
+  *res_sz = alloc_sz;
+  return (uint64_t*)first;
+}
+
+void dealloc_uint64list_block(uint64_t *value, size_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  uint64list_block_t *shared = (uint64list_block_t*)(((uintptr_t*)value)[-1] & ~UINT64LIST_BLOCK_TAG);
+  if (block_atomic_sub(&shared->refcnt, count) == 0) {
+    PyMem_RawFree(shared);
+  }
+
+  return;
+}
+
+uint64_t *alloc_uint64list(structint_arena_t *arena, uint64_t *value, size_t new_sz, size_t old_sz, size_t *res_sz) {
   if (new_sz <= old_sz) {
+    stats_alloc(StatsAllocReuse, new_sz, old_sz);
     if (res_sz != NULL) {
       *res_sz = old_sz;
     }
@@ -26,13 +115,24 @@ uint64_t *alloc_uint64list(uint64_t *value, size_t new_sz, size_t old_sz, size_t
     return value;
   }
 
-  size_t alloc_sz = round_size(new_sz, 8LL);  
-  uint64_t *new_value;
-  if (value == NULL) {
-    new_value = PyMem_RawMalloc(alloc_sz);
+  size_t alloc_sz = round_size(new_sz, STRUCTINT_VALUE_ALIGN);  
+  uint64_t *new_value = NULL;
+  if (arena != NULL) {
+    new_value = structint_arena_alloc(arena, alloc_sz);
+  }
+
+  // full arena falls back to heap
+  if (new_value != NULL) {
+    stats_alloc(StatsAllocArena, alloc_sz, old_sz);
   }
   else {
-    new_value = PyMem_RawRealloc(value, alloc_sz);
+    new_value = raw_aligned_alloc(alloc_sz);
+    stats_alloc((value == NULL) ? StatsAllocMalloc : StatsAllocRealloc, alloc_sz, old_sz);
+  }
+
+  if ((new_value != NULL) && (value != NULL)) {
+    memcpy(new_value, value, old_sz);
+    dealloc_uint64list(arena, value);
   }
 
   if (res_sz != NULL) {
@@ -42,21 +142,26 @@ uint64_t *alloc_uint64list(uint64_t *value, size_t new_sz, size_t old_sz, size_t
   return new_value;
 }
 
-void dealloc_uint64list(uint64_t *value) {
+void dealloc_uint64list(structint_arena_t *arena, uint64_t *value) {
+  if ((arena != NULL) && structint_arena_owns(arena, value)) {
+    return;
+  }
+
   if (value != NULL) {
-    PyMem_RawFree(value);
+    stats_alloc(StatsAllocFree, 0LL, 0LL);
+    raw_aligned_free(value);
   }
 
   return;
 }
 
-uint64_t *copy_uint64list(uint64_t *dst_value, size_t dst_sz, uint64_t *src_value, size_t src_sz, size_t *res_sz) {
+uint64_t *copy_uint64list(structint_arena_t *arena, uint64_t *dst_value, size_t dst_sz, uint64_t *src_value, size_t src_sz, size_t *res_sz) {
   size_t alloc_sz = get_true_value(dst_sz, src_sz);
   if (!res_sz) {
     return NULL;
   }
 
-  uint64_t *res_value = alloc_uint64list(dst_value, alloc_sz, 0LL, NULL);
+  uint64_t *res_value = alloc_uint64list(arena, dst_value, alloc_sz, 0LL, &alloc_sz);
   if (res_value == NULL) {
     return NULL;
   } 
@@ -140,7 +245,8 @@ structint_t *structint_set_null_value(structint_t *self) {
   }
 
   self->null = 1;
-  for (size_t i = 0; i < self->used_value_parts; ++i) {
+  size_t padded_parts = get_uint64list_padded_parts(self->used_value_parts);
+  for (size_t i = 0; i < padded_parts; ++i) {
     self->value[i] = 0LL;
   }
 
@@ -192,6 +298,12 @@ structint_t *structint_sign_smear(structint_t *self) {
     self->value[last_part_idx] &= part_mask;
   }  
 
+  uint64_t smear = sign ? 0xffffffffffffffffLL : 0LL;
+  size_t padded_parts = get_uint64list_padded_parts(self->used_value_parts);
+  for (size_t i = last_part_idx + 1; i < padded_parts; ++i) {
+    self->value[i] = smear;
+  }
+
   return self;
 }
 
@@ -201,6 +313,7 @@ structint_t *structint_convert_obj_and_selfstore(structint_t *self, PyObject *sr
     return NULL;
   }
 
+  stats_op_begin();
   structint_obj_t src_type = check_valueobj_type(src);
 
   size_t src_bit_len = 0, true_bit_len = 0, value_byte_sz = 0;
@@ -212,7 +325,7 @@ structint_t *structint_convert_obj_and_selfstore(structint_t *self, PyObject *sr
       true_bit_len = get_true_value(self->bit_len, src_bit_len);
       value_byte_sz = get_uint64list_bytesz_from_bitlen(true_bit_len);
 
-      value = alloc_uint64list(self->value, value_byte_sz, self->byte_sz, &value_byte_sz);
+      value = alloc_uint64list(self->arena, self->value, value_byte_sz, self->byte_sz, &value_byte_sz);
       if (value == NULL) {
         return (structint_t*)PyErr_NoMemory();
       }
@@ -222,6 +335,7 @@ structint_t *structint_convert_obj_and_selfstore(structint_t *self, PyObject *sr
         return NULL;
       }
 
+      stats_converted(Long, (src_bit_len + 7) / 8);
       break;
     }
     case ByteArray: case Bytes: {
@@ -236,13 +350,14 @@ structint_t *structint_convert_obj_and_selfstore(structint_t *self, PyObject *sr
       true_bit_len = get_true_value(self->bit_len, src_bit_len);
       value_byte_sz = get_uint64list_bytesz_from_bitlen(true_bit_len);
 
-      value = alloc_uint64list(self->value, value_byte_sz, self->byte_sz, &value_byte_sz);
+      value = alloc_uint64list(self->arena, self->value, value_byte_sz, self->byte_sz, &value_byte_sz);
       if (value == NULL) {
         PyBuffer_Release(&buf);
         return (structint_t*)PyErr_NoMemory();
       }
 
       convert_pybuffer_to_uint64list(value, true_bit_len, &buf);
+      stats_converted(src_type, buf.len);
 
       PyBuffer_Release(&buf);
       break;
@@ -251,7 +366,7 @@ structint_t *structint_convert_obj_and_selfstore(structint_t *self, PyObject *sr
       true_bit_len = get_true_value(self->bit_len, 1LL);
       value_byte_sz = get_uint64list_bytesz_from_bitlen(true_bit_len);
 
-      value = alloc_uint64list(self->value, value_byte_sz, self->byte_sz, &value_byte_sz);
+      value = alloc_uint64list(self->arena, self->value, value_byte_sz, self->byte_sz, &value_byte_sz);
       if (value == NULL) {
         return (structint_t*)PyErr_NoMemory();
       }
@@ -261,6 +376,7 @@ structint_t *structint_convert_obj_and_selfstore(structint_t *self, PyObject *sr
         return NULL;
       }
 
+      stats_converted(Bool, 1LL);
       break;
     }
     case None: {
@@ -268,11 +384,12 @@ structint_t *structint_convert_obj_and_selfstore(structint_t *self, PyObject *sr
 
       true_bit_len = get_true_value(self->bit_len, 0LL);
       value_byte_sz = get_uint64list_bytesz_from_bitlen(true_bit_len);
-      value = alloc_uint64list(self->value, value_byte_sz, self->byte_sz, &value_byte_sz);
+      value = alloc_uint64list(self->arena, self->value, value_byte_sz, self->byte_sz, &value_byte_sz);
       if (value == NULL) {
         return (structint_t*)PyErr_NoMemory();
       }
 
+      stats_converted(None, 0LL);
       break;
     }
     case TypeError: {
@@ -292,19 +409,58 @@ structint_t *structint_convert_obj_and_selfstore(structint_t *self, PyObject *sr
     structint_safe_set_all(self, value, value_byte_sz, true_bit_len, self->flags);
   }
 
+  stats_op_end(StatsOpConvert, self->used_value_parts);
   return self;
 }
 
+structint_t *structint_snapshot(structint_t *dst, structint_t *src) {
+  if ((dst == NULL) || (src == NULL)) {
+    PyErr_SetString(PyExc_SystemError, INTERNAL_LIB_ERROR_STR);
+    return NULL;
+  }
+
+  stats_op_begin();
+  structint_t *res = dst;
+  Py_BEGIN_CRITICAL_SECTION(src);
+  dst->value = NULL;
+  dst->byte_sz = 0LL;
+  if (src->value != NULL) {
+    dst->value = copy_uint64list(NULL, NULL, src->byte_sz, src->value, src->byte_sz, &dst->byte_sz);
+    if (dst->value == NULL) {
+      PyErr_NoMemory();
+      res = NULL;
+    }
+  }
+
+  if (res != NULL) {
+    dst->used_value_parts = src->used_value_parts;
+    structint_unsafe_copy(dst, src);
+  }
+  stats_op_end(StatsOpSnapshot, src->used_value_parts);
+  Py_END_CRITICAL_SECTION();
+
+  return res;
+}
+
+void structint_release_snapshot(structint_t *snapshot) {
+  dealloc_uint64list(NULL, snapshot->value);
+  snapshot->value = NULL;
+  snapshot->byte_sz = 0LL;
+  return;
+}
+
 PyObject *structint_print_value(structint_t *self, PyObject *Py_UNUSED(ignored)) {
+  Py_BEGIN_CRITICAL_SECTION(self);
   for (size_t i = 0; i < self->used_value_parts; ++i) {
     printf("%.16"PRIx64"\n", self->value[i]);
   }
+  Py_END_CRITICAL_SECTION();
 
   Py_INCREF(Py_None);
   return Py_None;
 }
 
-size_t structint_asymmetric_len_check(structint_t *a, structint_t *b) {
+size_t structint_asymmetric_len_check(structint_state *state, structint_t *a, structint_t *b) {
   if (a->flags & STRUCTINT_FLAGS_ASYMMETRIC_LEN) {
     return 0;
   }
@@ -312,7 +468,7 @@ size_t structint_asymmetric_len_check(structint_t *a, structint_t *b) {
   size_t left_len = a->bit_len;
   size_t right_len = b->bit_len;
   if (left_len != right_len) {
-    PyErr_Format(structintExc_AsymmetricError, ASYMMETRIC_LEN_ERROR_FMT, right_len, left_len);
+    PyErr_Format(state->AsymmetricError, ASYMMETRIC_LEN_ERROR_FMT, right_len, left_len);
     return -1;
   }
 
@@ -373,67 +529,92 @@ Py_buffer *convert_pybyteslike_to_pybuffer(Py_buffer *buf, PyObject *src) {
 }
 
 int convert_pybuffer_to_uint64list(uint64_t *value, size_t bit_len, Py_buffer *src) {
-  size_t byte_sz = src->len;
-  union V {
-    uint64_t u64;
-    uint8_t u8[8];
-  } v;
+  // buffer is big endian, so parts are read as whole words from its end
+  size_t byte_sz = (bit_len + 7) / 8;
+  size_t src_sz = ((size_t)src->len < byte_sz) ? (size_t)src->len : byte_sz;
+  const uint8_t *end = (uint8_t*)src->buf + src->len;
 
   size_t value_i = 0LL;
-  for (size_t i = 0LL; (i * 8) < bit_len; ++i) {
-    size_t u8_i = i % 8; 
-    if (i < byte_sz) {
-      v.u8[u8_i] = ((uint8_t*)src->buf)[byte_sz - i - 1];
-    }
-    else {
-      v.u8[u8_i] = 0;
+  for (; (value_i + 1) * 8 <= src_sz; ++value_i) {
+    uint64_t v;
+    memcpy(&v, end - (value_i + 1) * 8, 8);
+#if PY_BIG_ENDIAN
+    value[value_i] = v;
+#else
+    value[value_i] = uint64_bswap(v);
+#endif
+  }
+
+  // last, not fully filled part and zeros after a short buffer
+  for (size_t i = value_i * 8; i < byte_sz; i += 8, ++value_i) {
+    uint64_t v = 0LL;
+    for (size_t j = 0; (j < 8) && (i + j < src_sz); ++j) {
+      v |= (uint64_t)end[-(Py_ssize_t)(i + j) - 1] << (8 * j);
     }
 
-    if (u8_i == 7) {
-      value[value_i] = v.u64;
-      v.u64 = 0LL;
-      ++value_i;
-    }
+    value[value_i] = v;
   }
 
-  value[value_i] = v.u64;
   return 0;
 }
 
 int convert_pylong_to_uint64list(uint64_t *value, size_t bit_len, PyObject *src) {
-  uint64_t mask = 0xffffffffffffffffLL;
-  PyObject *pylong_mask = PyLong_FromUnsignedLongLong(mask);
-
+  // single part values are truncated by C API without temporary python objects
   if (bit_len <= 64) {
-    PyObject *pylong_value = PyNumber_And(src, pylong_mask);        
-    if (pylong_value == NULL) {
+    uint64_t v = PyLong_AsUnsignedLongLongMask(src);
+    if ((v == (uint64_t)-1) && PyErr_Occurred()) {
       return -1;
     }
 
-    value[0] = PyLong_AsUnsignedLongLong(pylong_value);
-
-    Py_XDECREF(pylong_value);
-    Py_XDECREF(pylong_mask);
+    value[0] = v;
     return 0;
   }
 
-  for (size_t i = 0LL; (i * 64) < bit_len; ++i) {
-    uint64_t shift = i * 64;
-    PyObject *pylong_shift = PyLong_FromUnsignedLongLong(shift);
-    PyObject *pylong_shifted_src = PyNumber_Rshift(src, pylong_shift);
-    PyObject *pylong_value_part = PyNumber_And(pylong_shifted_src, pylong_mask);
-    if (pylong_value_part == NULL) {
+  // bigger values are written as little endian two's complement in one pass
+  size_t parts = get_uint64list_idx_by_bit(bit_len) + 1;
+#if PY_VERSION_HEX >= 0x030D0000
+  // too big values are truncated to the lower bytes
+  if (PyLong_AsNativeBytes(src, value, parts * 8, Py_ASNATIVEBYTES_LITTLE_ENDIAN) < 0) {
+    return -1;
+  }
+#else
+  int is_signed = _PyLong_Sign(src) < 0;
+  if (_PyLong_AsByteArray((PyLongObject*)src, (unsigned char*)value, parts * 8, 1, is_signed)) {
+    if (!PyErr_ExceptionMatches(PyExc_OverflowError)) {
       return -1;
     }
 
-    value[i] = PyLong_AsUnsignedLongLong(pylong_value_part);
+    // too big value is written whole and truncated to the lower parts
+    PyErr_Clear();
+    size_t full_sz = _PyLong_NumBits(src) / 8 + 1;
+    unsigned char *full = PyMem_Malloc(full_sz);
+    if (full == NULL) {
+      PyErr_NoMemory();
+      return -1;
+    }
+
+    if (_PyLong_AsByteArray((PyLongObject*)src, full, full_sz, 1, is_signed)) {
+      PyMem_Free(full);
+      return -1;
+    }
+
+    memcpy(value, full, parts * 8);
+    PyMem_Free(full);
+  }
+#endif
+
+#if PY_BIG_ENDIAN
+  for (size_t i = 0LL; i < parts; ++i) {
+    uint8_t *bytes = (uint8_t*)&value[i];
+    uint64_t part = 0LL;
+    for (size_t j = 0LL; j < 8; ++j) {
+      part |= (uint64_t)bytes[j] << (8 * j);
+    }
 
-    Py_XDECREF(pylong_shift);
-    Py_XDECREF(pylong_shifted_src);
-    Py_XDECREF(pylong_value_part);
+    value[i] = part;
   }
+#endif
 
-  Py_XDECREF(pylong_mask);
   return 0;
 }
 
@@ -22,8 +22,41 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+/*
+ * Free-threaded builds (3.13t) run without the GIL, so every read or write of a structint
+ * which can be shared between threads is done inside the object's critical section.
+ * Interpreters older than 3.13 don't provide these macros, but there the GIL already 
+ * serializes all accesses
+ */
+#if PY_VERSION_HEX < 0x030D0000
+#define Py_BEGIN_CRITICAL_SECTION(op) {
+#define Py_END_CRITICAL_SECTION() }
+#define Py_BEGIN_CRITICAL_SECTION2(a, b) {
+#define Py_END_CRITICAL_SECTION2() }
+#endif
 
-typedef struct {
+/*
+ * Heap types with module state need 3.9, reference helpers below came in 3.10
+ */
+#if PY_VERSION_HEX < 0x030A0000
+static inline PyObject *Py_NewRef(PyObject *obj) {
+  Py_INCREF(obj);
+  return obj;
+}
+
+static inline int PyModule_AddObjectRef(PyObject *module, const char *name, PyObject *value) {
+  int res = PyModule_AddObject(module, name, value);
+  if (res == 0) {
+    Py_INCREF(value);
+  }
+
+  return res;
+}
+#endif
+
+typedef struct structint_arena_s structint_arena_t;
+
+typedef struct structint_s {
   PyObject_HEAD
 
   uint64_t *value;
@@ -61,25 +94,82 @@ typedef struct {
   char carry;
   char overflow;
   char null;
+
+  // count of buffers exported for pickle protocol 5, value can't change while it isn't 0
+  Py_ssize_t exports;
+
+  // arena which value is allocated from, NULL if value is owned (see arena.h)
+  structint_arena_t *arena;
+  struct structint_s *arena_prev;
+  struct structint_s *arena_next;
 } structint_t;
 
-PyObject *structintExc_AsymmetricError;
-PyObject *structintExc_CarryError;
-PyObject *structintExc_NullError;
+/*
+ * Per-module state. Every (sub)interpreter which imports structint gets its own copy,
+ * so nothing here may be shared between interpreters
+ */
+typedef struct {
+  PyTypeObject *structint_Type;
+  PyTypeObject *arena_Type;
+  PyTypeObject *expr_Type;
+
+  PyObject *AsymmetricError;
+  PyObject *CarryError;
+  PyObject *NullError;
+} structint_state;
+
+structint_state *structint_get_module_state(PyObject *module);
+PyObject *structint_get_module(PyObject *obj);
+/*
+ * structint_get_state() finds the state through the type of a structint (or its subclass)
+ * object. It returns NULL with exception set if 'obj' doesn't come from this module
+ */
+structint_state *structint_get_state(PyObject *obj);
+
 #define INTERNAL_LIB_ERROR_STR "internal structint error"
 #define TYPE_OBJ_ERROR_STR "first argument must be a int, a bytes, a bytearray, a bool, a none or another structint object"
-#define ASYMMETRIC_LEN_ERROR_FMT "right side has bit lentgh %z but left side requires %z"
+#define ASYMMETRIC_LEN_ERROR_FMT "right side has bit length %zu but left side requires %zu"
 
-uint64_t *alloc_uint64list(uint64_t *value, size_t new_sz, size_t old_sz, size_t *res_sz);
-void dealloc_uint64list(uint64_t *value);
+/*
+ * alloc_uint64list() can move 'value' (realloc), so the caller must hold the critical 
+ * section of the structint object which owns 'value'.
+ * 'arena' is the arena of this structint object read under the same critical section 
+ * (arena promotion changes it under it too), NULL means PyMem_Raw* allocation
+ */
+uint64_t *alloc_uint64list(structint_arena_t *arena, uint64_t *value, size_t new_sz, size_t old_sz, size_t *res_sz);
+void dealloc_uint64list(structint_arena_t *arena, uint64_t *value);
 /* 
  * dst_value and dst_sz are optional. Default values are NULL and 0. 
  * This function doesn't lose the origin of dst_value
  */
-uint64_t *copy_uint64list(uint64_t *dst_value, size_t dst_sz, uint64_t *src_value, size_t src_sz, size_t *res_sz);
+uint64_t *copy_uint64list(structint_arena_t *arena, uint64_t *dst_value, size_t dst_sz, uint64_t *src_value, size_t src_sz, size_t *res_sz);
+/*
+ * alloc_uint64list_block() allocates 'count' uint64lists of 'sz' bytes from one shared block,
+ * the i-th one starts get_uint64list_block_stride(*res_sz) * i bytes after the returned one.
+ * Each of them is released by dealloc_uint64list() (or moved by alloc_uint64list()) on its own
+ * and the block is freed with the last one. dealloc_uint64list_block() releases 'count' 
+ * consecutive uint64lists which starts with 'value' and weren't given to any structint
+ */
+uint64_t *alloc_uint64list_block(size_t count, size_t sz, size_t *res_sz);
+void dealloc_uint64list_block(uint64_t *value, size_t count);
+#define get_uint64list_block_stride(sz) ((sz) + STRUCTINT_VALUE_ALIGN)
 size_t round_size(size_t value, size_t base);
 #define get_uint64list_idx_by_bit(bit) ((round_size(bit, 64LL) / 64) - 1)
-#define get_uint64list_bytesz_from_bitlen(bit) (round_size(bit, 8LL))
+#define get_uint64list_bytesz_from_bitlen(bit) (round_size(bit, 64LL) / 8)
+/*
+ * uint64lists are 64 byte aligned and padded to whole vectors of STRUCTINT_VECTOR_PARTS
+ * parts. Padding parts after used_value_parts always hold the sign (or zero) smear, so 
+ * kernels can run full-width vector iterations without a scalar tail
+ */
+#define STRUCTINT_VALUE_ALIGN 64LL
+#define STRUCTINT_VECTOR_PARTS (STRUCTINT_VALUE_ALIGN / 8)
+#define get_uint64list_padded_parts(parts) (round_size(parts, STRUCTINT_VECTOR_PARTS))
+
+#if defined(_MSC_VER)
+#define uint64_bswap(v) _byteswap_uint64(v)
+#else
+#define uint64_bswap(v) __builtin_bswap64(v)
+#endif
 
 PyObject *structint_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
 int structint_init(structint_t *self, PyObject *args, PyObject *kwds);
@@ -112,10 +202,21 @@ structint_t *structint_unsafe_copy(structint_t *self, structint_t *src);
  * These parameters can be transferred unsafe (without using safe_set_all...)
  */
 structint_t *structint_convert_obj_and_selfstore(structint_t *self, PyObject *src);
+/*
+ * structint_snapshot() copies parameters and value of 'src' to 'dst' under the critical 
+ * section of 'src'. Binary operators read their right side from the snapshot, so another 
+ * thread can't modify or realloc it in the middle of an operation.
+ * 'dst' owns the copied value and must be released by structint_release_snapshot()
+ */
+structint_t *structint_snapshot(structint_t *dst, structint_t *src);
+void structint_release_snapshot(structint_t *snapshot);
 PyObject *structint_print_value(structint_t *self, PyObject *Py_UNUSED(ignored));
 
-size_t structint_asymmetric_len_check(structint_t *a, structint_t *b);
-#define structint_type_check(obj) (PyObject_TypeCheck(arg_obj, &structint_Type))
+/*
+ * 'state' is passed by caller, because 'a' and 'b' may be snapshots without a type
+ */
+size_t structint_asymmetric_len_check(structint_state *state, structint_t *a, structint_t *b);
+#define structint_type_check(state, obj) (PyObject_TypeCheck(obj, (state)->structint_Type))
 structint_t *structint_overflow(structint_t *self);
 
 typedef enum  {
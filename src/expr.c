@@ -0,0 +1,702 @@
+/*
+ * This file is part of StructInt.
+ *
+ * StructInt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * StructInt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with StructInt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "expr.h"
+#include "stats.h"
+
+#include <ctype.h>
+
+#define EXPR_ERROR ((size_t)-1)
+
+typedef struct {
+  const char *src;
+  Py_ssize_t len;
+  Py_ssize_t pos;
+  int depth;
+
+  expr_node_t *nodes;
+  size_t node_count;
+  size_t node_cap;
+  PyObject *names;
+} expr_parser_t;
+
+static size_t parse_or(expr_parser_t *p);
+
+static char parse_peek(expr_parser_t *p) {
+  while ((p->pos < p->len) && isspace((unsigned char)p->src[p->pos])) {
+    ++p->pos;
+  }
+
+  return (p->pos < p->len) ? p->src[p->pos] : '\0';
+}
+
+static size_t parse_syntax_error(expr_parser_t *p) {
+  PyErr_Format(PyExc_ValueError, EXPR_SYNTAX_ERROR_FMT, p->pos);
+  return EXPR_ERROR;
+}
+
+static size_t parse_add_node(expr_parser_t *p, expr_op_t op, size_t a, size_t b, size_t arg) {
+  if (p->node_count == STRUCTINT_EXPR_MAX_NODES) {
+    PyErr_SetString(PyExc_ValueError, EXPR_NODES_ERROR_STR);
+    return EXPR_ERROR;
+  }
+
+  if (p->node_count == p->node_cap) {
+    size_t new_cap = (p->node_cap == 0) ? 16 : p->node_cap * 2;
+    expr_node_t *nodes = PyMem_Realloc(p->nodes, new_cap * sizeof(expr_node_t));
+    if (nodes == NULL) {
+      PyErr_NoMemory();
+      return EXPR_ERROR;
+    }
+
+    p->nodes = nodes;
+    p->node_cap = new_cap;
+  }
+
+  expr_node_t *node = &p->nodes[p->node_count];
+  node->op = op;
+  node->a = a;
+  node->b = b;
+  node->arg = arg;
+  return p->node_count++;
+}
+
+static size_t parse_operand(expr_parser_t *p) {
+  Py_ssize_t begin = p->pos;
+  while ((p->pos < p->len) && (isalnum((unsigned char)p->src[p->pos]) || (p->src[p->pos] == '_'))) {
+    ++p->pos;
+  }
+
+  PyObject *name = PyUnicode_FromStringAndSize(p->src + begin, p->pos - begin);
+  if (name == NULL) {
+    return EXPR_ERROR;
+  }
+
+  // every name is one operand, no matter how many times it is used
+  Py_ssize_t idx = PySequence_Index(p->names, name);
+  if (idx == -1) {
+    PyErr_Clear();
+    idx = PyList_GET_SIZE(p->names);
+    if (PyList_Append(p->names, name)) {
+      Py_DECREF(name);
+      return EXPR_ERROR;
+    }
+  }
+
+  Py_DECREF(name);
+  return parse_add_node(p, ExprOperand, 0, 0, idx);
+}
+
+static size_t parse_unary(expr_parser_t *p) {
+  if (++p->depth > STRUCTINT_EXPR_MAX_DEPTH) {
+    PyErr_SetString(PyExc_ValueError, EXPR_DEPTH_ERROR_STR);
+    return EXPR_ERROR;
+  }
+
+  size_t res;
+  char c = parse_peek(p);
+  if (c == '~') {
+    ++p->pos;
+    res = parse_unary(p);
+    if (res != EXPR_ERROR) {
+      res = parse_add_node(p, ExprInvert, res, 0, 0);
+    }
+  }
+  else if (c == '(') {
+    ++p->pos;
+    res = parse_or(p);
+    if (res != EXPR_ERROR) {
+      if (parse_peek(p) != ')') {
+        return parse_syntax_error(p);
+      }
+
+      ++p->pos;
+    }
+  }
+  else if (isalpha((unsigned char)c) || (c == '_')) {
+    res = parse_operand(p);
+  }
+  else {
+    return parse_syntax_error(p);
+  }
+
+  --p->depth;
+  return res;
+}
+
+static size_t parse_shift_count(expr_parser_t *p) {
+  if (!isdigit((unsigned char)parse_peek(p))) {
+    return parse_syntax_error(p);
+  }
+
+  size_t count = 0LL;
+  while ((p->pos < p->len) && isdigit((unsigned char)p->src[p->pos])) {
+    count = count * 10 + (p->src[p->pos] - '0');
+    if (count > STRUCTINT_EXPR_MAX_SHIFT) {
+      PyErr_SetString(PyExc_ValueError, EXPR_SHIFT_ERROR_STR);
+      return EXPR_ERROR;
+    }
+
+    ++p->pos;
+  }
+
+  return count;
+}
+
+static size_t parse_shift(expr_parser_t *p) {
+  size_t res = parse_unary(p);
+  while (res != EXPR_ERROR) {
+    char c = parse_peek(p);
+    if (((c != '<') && (c != '>')) || (p->pos + 1 >= p->len) || (p->src[p->pos + 1] != c)) {
+      break;
+    }
+
+    p->pos += 2;
+    size_t count = parse_shift_count(p);
+    if (count == EXPR_ERROR) {
+      return EXPR_ERROR;
+    }
+
+    res = parse_add_node(p, (c == '<') ? ExprShl : ExprShr, res, 0, count);
+  }
+
+  return res;
+}
+
+static size_t parse_binary(expr_parser_t *p, expr_op_t op, char op_char, size_t (*parse_next)(expr_parser_t*)) {
+  size_t res = parse_next(p);
+  while ((res != EXPR_ERROR) && (parse_peek(p) == op_char)) {
+    ++p->pos;
+    size_t b = parse_next(p);
+    if (b == EXPR_ERROR) {
+      return EXPR_ERROR;
+    }
+
+    res = parse_add_node(p, op, res, b, 0);
+  }
+
+  return res;
+}
+
+static size_t parse_and(expr_parser_t *p) {
+  return parse_binary(p, ExprAnd, '&', parse_shift);
+}
+
+static size_t parse_xor(expr_parser_t *p) {
+  return parse_binary(p, ExprXor, '^', parse_and);
+}
+
+static size_t parse_or(expr_parser_t *p) {
+  return parse_binary(p, ExprOr, '|', parse_xor);
+}
+
+
+/*
+ * Fused evaluation runs the nodes as a postfix program (children always precede their 
+ * parent) over blocks of EXPR_BLOCK_PARTS parts with a stack of blocks, so no temporary 
+ * structint exists for inner nodes and every node is evaluated once per part.
+ * Each node reads its own stream of parts shifted by 'offset' against the result: a shift 
+ * moves the stream of its child by the whole parts of the count and keeps the last part 
+ * of the previous block in 'carry'. Evaluation starts early enough to fill every carry 
+ * before it's needed.
+ * Bits above bit_len of inner nodes aren't smeared, so shifts to the right smear the top 
+ * part of their child and use 'fill' for parts above it
+ */
+#define EXPR_BLOCK_PARTS (4 * STRUCTINT_VECTOR_PARTS)
+#define EXPR_LOCAL_BUF_SZ 2048
+
+typedef struct {
+  Py_ssize_t offset;
+  Py_ssize_t start;  // first position of result at which the node must be valid
+  size_t shift;
+  uint64_t carry;
+  uint64_t fill;
+} expr_slot_t;
+
+typedef struct {
+  Py_ssize_t block_parts;  // at most EXPR_BLOCK_PARTS, less for small results
+  Py_ssize_t used_value_parts;
+  size_t bit_len;
+  uint64_t sign_mask;
+  bool is_unsigned;
+} expr_eval_t;
+
+static void expr_load_operand(expr_eval_t *ev, uint64_t *dst, structint_t *op, Py_ssize_t first) {
+  // padding parts are already smeared (see structint_sign_smear)
+  Py_ssize_t padded_parts = get_uint64list_padded_parts(op->used_value_parts);
+  if ((first >= 0) && (first + ev->block_parts <= padded_parts)) {
+    memcpy(dst, op->value + first, ev->block_parts * sizeof(uint64_t));
+    return;
+  }
+
+  uint64_t fill = 0LL;
+  if (!(op->flags & STRUCTINT_FLAGS_UNSIGNED)) {
+    fill = (uint64_t)((int64_t)op->value[op->used_value_parts - 1] >> 63);
+  }
+
+  for (Py_ssize_t t = 0; t < ev->block_parts; ++t) {
+    Py_ssize_t i = first + t;
+    dst[t] = (i < 0) ? 0LL : ((i < padded_parts) ? op->value[i] : fill);
+  }
+
+  return;
+}
+
+/*
+ * 'first' - index of the first part of child block, parts below index 0 are zeros
+ */
+static void expr_shl(expr_eval_t *ev, uint64_t *block, expr_slot_t *slot, Py_ssize_t first) {
+  for (Py_ssize_t t = 0; (t < ev->block_parts) && (first + t < 0); ++t) {
+    block[t] = 0LL;
+  }
+
+  size_t r = slot->shift % 64;
+  uint64_t prev = slot->carry;
+  slot->carry = block[ev->block_parts - 1];
+  if (r == 0) {
+    return;
+  }
+
+  for (Py_ssize_t t = 0; t < ev->block_parts; ++t) {
+    uint64_t cur = block[t];
+    block[t] = (cur << r) | (prev >> (64 - r));
+    prev = cur;
+  }
+
+  return;
+}
+
+/*
+ * 'first' - index of the first part of child block, it's the higher part of the pair 
+ * shifted into the first part of result
+ */
+static void expr_shr(expr_eval_t *ev, uint64_t *block, expr_slot_t *slot, Py_ssize_t first) {
+  Py_ssize_t last_part_idx = ev->used_value_parts - 1;
+  if ((last_part_idx >= first) && (last_part_idx < first + ev->block_parts)) {
+    uint64_t last_part = block[last_part_idx - first];
+    uint64_t part_mask = get_bit_partmask(ev->sign_mask);
+    bool sign = !ev->is_unsigned && (last_part & ev->sign_mask);
+    block[last_part_idx - first] = sign ? (last_part | ~part_mask) : (last_part & part_mask);
+    slot->fill = sign ? 0xffffffffffffffffLL : 0LL;
+  }
+
+  size_t r = slot->shift % 64;
+  uint64_t prev = slot->carry;
+  if ((r != 0) && (first + ev->block_parts - 1 <= last_part_idx)) {
+    for (Py_ssize_t t = 0; t < ev->block_parts; ++t) {
+      uint64_t cur = block[t];
+      block[t] = (prev >> r) | (cur << (64 - r));
+      prev = cur;
+    }
+
+    slot->carry = prev;
+    return;
+  }
+
+  for (Py_ssize_t t = 0; t < ev->block_parts; ++t) {
+    uint64_t cur = block[t];
+    uint64_t hi = (first + t > last_part_idx) ? slot->fill : cur;
+    uint64_t lo = (first + t - 1 > last_part_idx) ? slot->fill : prev;
+    block[t] = (r == 0) ? lo : ((lo >> r) | (hi << (64 - r)));
+    prev = cur;
+  }
+
+  slot->carry = prev;
+  return;
+}
+
+/*
+ * offsets depend on width of the result, so they are computed per call. Shifting to the 
+ * right by bit_len or more gives only 'fill', so such counts are limited to bit_len.
+ * Returns the first position of evaluation
+ */
+static Py_ssize_t expr_set_offsets(structint_expr_t *self, expr_eval_t *ev, expr_slot_t *slots) {
+  Py_ssize_t res = 0;
+  slots[self->root].offset = 0;
+  slots[self->root].start = 0;
+  for (size_t n = self->node_count; n-- > 0;) {
+    expr_node_t *node = &self->nodes[n];
+    expr_slot_t *slot = &slots[n];
+    res = Py_MIN(res, slot->start);
+    switch (node->op) {
+      case ExprOperand: {
+        break;
+      }
+      case ExprShl: {
+        slot->shift = node->arg;
+        slots[node->a].offset = slot->offset - (Py_ssize_t)(slot->shift / 64);
+        slots[node->a].start = slot->start - 1;
+        break;
+      }
+      case ExprShr: {
+        // the child stream must pass its top part to set 'fill'
+        slot->shift = Py_MIN(node->arg, ev->bit_len);
+        Py_ssize_t offset = slot->offset + (Py_ssize_t)(slot->shift / 64) + 1;
+        slots[node->a].offset = offset;
+        slots[node->a].start = Py_MIN(slot->start - 1, ev->used_value_parts - 1 - offset);
+        break;
+      }
+      case ExprAnd:
+      case ExprXor:
+      case ExprOr: {
+        slots[node->b].offset = slot->offset;
+        slots[node->b].start = slot->start;
+      }
+      // fall through
+      case ExprInvert: {
+        slots[node->a].offset = slot->offset;
+        slots[node->a].start = slot->start;
+        break;
+      }
+    }
+  }
+
+  return res;
+}
+
+/*
+ * 'dst_parts' - number of parts allocated for 'dst'
+ */
+static void expr_eval(structint_expr_t *self, expr_eval_t *ev, structint_t **operands, expr_slot_t *slots, uint64_t *stack, uint64_t *dst, Py_ssize_t dst_parts) {
+  Py_ssize_t start = expr_set_offsets(self, ev, slots);
+  ev->block_parts = Py_MIN(EXPR_BLOCK_PARTS, ev->used_value_parts - start);
+  for (Py_ssize_t pos = start; pos < ev->used_value_parts; pos += ev->block_parts) {
+    uint64_t *top = stack;
+    size_t stack_sz = 0;
+    for (size_t n = 0; n < self->node_count; ++n) {
+      expr_node_t *node = &self->nodes[n];
+      expr_slot_t *slot = &slots[n];
+      switch (node->op) {
+        case ExprOperand: {
+          top = &stack[(stack_sz++) * EXPR_BLOCK_PARTS];
+          expr_load_operand(ev, top, operands[node->arg], pos + slot->offset);
+          break;
+        }
+        case ExprInvert: {
+          for (Py_ssize_t t = 0; t < ev->block_parts; ++t) {
+            top[t] = ~top[t];
+          }
+          break;
+        }
+        case ExprShl: {
+          expr_shl(ev, top, slot, pos + slots[node->a].offset);
+          break;
+        }
+        case ExprShr: {
+          expr_shr(ev, top, slot, pos + slots[node->a].offset);
+          break;
+        }
+        case ExprAnd: {
+          top = &stack[(--stack_sz - 1) * EXPR_BLOCK_PARTS];
+          for (Py_ssize_t t = 0; t < ev->block_parts; ++t) {
+            top[t] &= top[t + EXPR_BLOCK_PARTS];
+          }
+          break;
+        }
+        case ExprXor: {
+          top = &stack[(--stack_sz - 1) * EXPR_BLOCK_PARTS];
+          for (Py_ssize_t t = 0; t < ev->block_parts; ++t) {
+            top[t] ^= top[t + EXPR_BLOCK_PARTS];
+          }
+          break;
+        }
+        case ExprOr: {
+          top = &stack[(--stack_sz - 1) * EXPR_BLOCK_PARTS];
+          for (Py_ssize_t t = 0; t < ev->block_parts; ++t) {
+            top[t] |= top[t + EXPR_BLOCK_PARTS];
+          }
+          break;
+        }
+      }
+    }
+
+    Py_ssize_t i = Py_MAX(pos, 0);
+    if (i < pos + ev->block_parts) {
+      memcpy(dst + i, stack + (i - pos), (Py_MIN(pos + ev->block_parts, dst_parts) - i) * sizeof(uint64_t));
+    }
+  }
+
+  return;
+}
+
+/*
+ * computes depth of the block stack
+ */
+static void expr_compile(structint_expr_t *self) {
+  size_t stack_sz = 0;
+  for (size_t n = 0; n < self->node_count; ++n) {
+    switch (self->nodes[n].op) {
+      case ExprOperand: {
+        self->stack_sz = Py_MAX(self->stack_sz, ++stack_sz);
+        break;
+      }
+      case ExprAnd:
+      case ExprXor:
+      case ExprOr: {
+        --stack_sz;
+        break;
+      }
+      default: {
+        break;
+      }
+    }
+  }
+
+  return;
+}
+
+
+static PyObject *expr_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+  static char *kwlist[] = {"source", NULL};
+  PyObject *arg_source;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "U", kwlist, &arg_source)) {
+    PyErr_BadArgument();
+    return NULL;
+  }
+
+  expr_parser_t p = {0};
+  p.src = PyUnicode_AsUTF8AndSize(arg_source, &p.len);
+  if (p.src == NULL) {
+    return NULL;
+  }
+
+  p.names = PyList_New(0);
+  if (p.names == NULL) {
+    return NULL;
+  }
+
+  size_t root = parse_or(&p);
+  if ((root != EXPR_ERROR) && (parse_peek(&p) != '\0')) {
+    root = parse_syntax_error(&p);
+  }
+
+  structint_expr_t *self = NULL;
+  if (root != EXPR_ERROR) {
+    self = (structint_expr_t*)type->tp_alloc(type, 0);
+  }
+
+  if (self == NULL) {
+    PyMem_Free(p.nodes);
+    Py_DECREF(p.names);
+    return NULL;
+  }
+
+  self->operands = PyList_AsTuple(p.names);
+  Py_DECREF(p.names);
+  if (self->operands == NULL) {
+    PyMem_Free(p.nodes);
+    Py_DECREF(self);
+    return NULL;
+  }
+
+  self->source = Py_NewRef(arg_source);
+  self->nodes = p.nodes;
+  self->node_count = p.node_count;
+  self->root = root;
+  expr_compile(self);
+  return (PyObject*)self;
+}
+
+static void expr_dealloc(structint_expr_t *self) {
+  PyTypeObject *type = Py_TYPE(self);
+  Py_XDECREF(self->source);
+  Py_XDECREF(self->operands);
+  PyMem_Free(self->nodes);
+  type->tp_free((PyObject*)self);
+  Py_DECREF(type);
+  return;
+}
+
+/*
+ * collects operands in order of expr.operands from positional or keyword arguments
+ */
+static int expr_get_operands(structint_expr_t *self, structint_state *state, PyObject *args, PyObject *kwds, structint_t **operands) {
+  Py_ssize_t n = PyTuple_GET_SIZE(self->operands);
+  Py_ssize_t n_args = PyTuple_GET_SIZE(args);
+  Py_ssize_t n_kwds = (kwds != NULL) ? PyDict_GET_SIZE(kwds) : 0;
+  if (n_args + n_kwds != n) {
+    PyErr_Format(PyExc_TypeError, EXPR_OPERANDS_ERROR_FMT, n, n_args + n_kwds);
+    return -1;
+  }
+
+  for (Py_ssize_t i = 0; i < n; ++i) {
+    PyObject *obj;
+    if (i < n_args) {
+      obj = PyTuple_GET_ITEM(args, i);
+    }
+    else {
+      obj = PyDict_GetItemWithError(kwds, PyTuple_GET_ITEM(self->operands, i));
+      if (obj == NULL) {
+        if (!PyErr_Occurred()) {
+          PyErr_Format(PyExc_TypeError, EXPR_MISSING_ERROR_FMT, PyTuple_GET_ITEM(self->operands, i));
+        }
+
+        return -1;
+      }
+    }
+
+    if (!structint_type_check(state, obj) || (((structint_t*)obj)->value == NULL)) {
+      PyErr_SetString(PyExc_TypeError, EXPR_OPERAND_TYPE_ERROR_STR);
+      return -1;
+    }
+
+    operands[i] = (structint_t*)obj;
+  }
+
+  return 0;
+}
+
+static PyObject *expr_call(structint_expr_t *self, PyObject *args, PyObject *kwds) {
+  structint_state *state = structint_get_state((PyObject*)self);
+  if (state == NULL) {
+    return NULL;
+  }
+
+  stats_op_begin();
+  Py_ssize_t n = PyTuple_GET_SIZE(self->operands);
+  structint_t **operands = PyMem_Calloc(n, sizeof(structint_t*));
+  if (operands == NULL) {
+    return PyErr_NoMemory();
+  }
+
+  structint_t *res = NULL;
+#ifdef Py_GIL_DISABLED
+  Py_ssize_t n_snapshots = 0;
+  // operands can't be locked all together, so the evaluation reads private snapshots
+  structint_t *snapshots = PyMem_Calloc(n, sizeof(structint_t));
+  if (snapshots == NULL) {
+    PyErr_NoMemory();
+    goto end;
+  }
+#endif
+
+  if (expr_get_operands(self, state, args, kwds, operands)) {
+    goto end;
+  }
+
+#ifdef Py_GIL_DISABLED
+  for (; n_snapshots < n; ++n_snapshots) {
+    if (structint_snapshot(&snapshots[n_snapshots], operands[n_snapshots]) == NULL) {
+      goto end;
+    }
+
+    operands[n_snapshots] = &snapshots[n_snapshots];
+  }
+#endif
+
+  // widths are checked once against the first operand, not for every operator
+  structint_t *first = operands[0];
+  for (Py_ssize_t i = 1; i < n; ++i) {
+    if (structint_asymmetric_len_check(state, first, operands[i])) {
+      goto end;
+    }
+  }
+
+  res = (structint_t*)structint_new(state->structint_Type, NULL, NULL);
+  if (res == NULL) {
+    goto end;
+  }
+
+  size_t byte_sz = get_uint64list_bytesz_from_bitlen(first->bit_len);
+  res->value = alloc_uint64list(res->arena, NULL, byte_sz, 0LL, &res->byte_sz);
+  if (res->value == NULL) {
+    Py_CLEAR(res);
+    PyErr_NoMemory();
+    goto end;
+  }
+
+  res->used_value_parts = get_uint64list_idx_by_bit(first->bit_len) + 1;
+  structint_unsafe_copy(res, first);
+  res->asymmetric = 0;
+  res->carry = 0;
+  res->overflow = 0;
+  if (res->bit_len == 0) {
+    structint_set_null_value(res);
+    goto end;
+  }
+
+  // slots of nodes and the block stack share one buffer, small programs use the C stack
+  uint64_t local_buf[EXPR_LOCAL_BUF_SZ / sizeof(uint64_t)];
+  size_t slots_sz = self->node_count * sizeof(expr_slot_t);
+  size_t stack_sz = self->stack_sz * EXPR_BLOCK_PARTS * sizeof(uint64_t);
+  expr_slot_t *slots = (expr_slot_t*)local_buf;
+  if (slots_sz + stack_sz > sizeof(local_buf)) {
+    slots = PyMem_Malloc(slots_sz + stack_sz);
+    if (slots == NULL) {
+      Py_CLEAR(res);
+      PyErr_NoMemory();
+      goto end;
+    }
+  }
+
+  memset(slots, 0, slots_sz);
+
+  res->null = 0;
+  res->sign_mask = get_signbit_mask(res->bit_len);
+  expr_eval_t ev = {
+    .used_value_parts = res->used_value_parts,
+    .bit_len = res->bit_len,
+    .sign_mask = res->sign_mask,
+    .is_unsigned = (res->flags & STRUCTINT_FLAGS_UNSIGNED) != 0,
+  };
+
+  expr_eval(self, &ev, operands, slots, (uint64_t*)((char*)slots + slots_sz), res->value, res->byte_sz / sizeof(uint64_t));
+  if (slots != (expr_slot_t*)local_buf) {
+    PyMem_Free(slots);
+  }
+
+  structint_sign_smear(res);
+  stats_op_end(StatsOpExpr, res->used_value_parts);
+
+end:
+#ifdef Py_GIL_DISABLED
+  if (snapshots != NULL) {
+    for (Py_ssize_t i = 0; i < n_snapshots; ++i) {
+      structint_release_snapshot(&snapshots[i]);
+    }
+
+    PyMem_Free(snapshots);
+  }
+#endif
+  PyMem_Free(operands);
+  return (PyObject*)res;
+}
+
+
+static PyMemberDef expr_members[] = {
+  {"source", T_OBJECT_EX, offsetof(structint_expr_t, source), READONLY},
+  {"operands", T_OBJECT_EX, offsetof(structint_expr_t, operands), READONLY},
+  {NULL}
+};
+
+static PyType_Slot expr_slots[] = {
+  {Py_tp_doc, PyDoc_STR(EXPR_DOCSTR)},
+  {Py_tp_new, expr_new},
+  {Py_tp_dealloc, expr_dealloc},
+  {Py_tp_call, expr_call},
+  {Py_tp_members, expr_members},
+  {0, NULL}
+};
+
+PyType_Spec structint_expr_spec = {
+  .name = "structint.expr",
+  .basicsize = sizeof(structint_expr_t),
+  .itemsize = 0,
+  .flags = Py_TPFLAGS_DEFAULT,
+  .slots = expr_slots,
+};
@@ -0,0 +1,67 @@
+/*
+ * This file is part of StructInt.
+ *
+ * StructInt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * StructInt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with StructInt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "core.h"
+
+#define EXPR_DOCSTR "expr(source)\n\ncompiled bitwise formula like \"(a & m) ^ (b >> 3) | c\" with operators ~ << >> & ^ | and parentheses. Calling it with structints (by position in order of first appearance or by name) returns a new structint computed in one pass"
+
+#define STRUCTINT_EXPR_MAX_DEPTH 64
+#define STRUCTINT_EXPR_MAX_NODES 1024
+#define STRUCTINT_EXPR_MAX_SHIFT (1LL << 40)
+
+#define EXPR_SYNTAX_ERROR_FMT "invalid expression at position %zd"
+#define EXPR_DEPTH_ERROR_STR "expression is nested too deeply"
+#define EXPR_NODES_ERROR_STR "expression is too long"
+#define EXPR_SHIFT_ERROR_STR "shift count is too large"
+#define EXPR_OPERANDS_ERROR_FMT "expression takes %zd operands (%zd given)"
+#define EXPR_MISSING_ERROR_FMT "missing operand '%U'"
+#define EXPR_OPERAND_TYPE_ERROR_STR "operands must be structint objects"
+
+typedef enum {
+  ExprOperand,
+  ExprInvert,
+  ExprShl,
+  ExprShr,
+  ExprAnd,
+  ExprXor,
+  ExprOr
+} expr_op_t;
+
+/*
+ * a, b - indexes of child nodes
+ * arg - operand index for ExprOperand, shift count for ExprShl and ExprShr
+ */
+typedef struct {
+  expr_op_t op;
+  size_t a;
+  size_t b;
+  size_t arg;
+} expr_node_t;
+
+typedef struct {
+  PyObject_HEAD
+
+  PyObject *source;
+  PyObject *operands;  // tuple of operand names
+  expr_node_t *nodes;
+  size_t node_count;
+  size_t root;  // nodes are in postfix order, so root is always the last one
+  size_t stack_sz;  // maximal number of blocks on the evaluation stack
+} structint_expr_t;
+
+extern PyType_Spec structint_expr_spec;
@@ -0,0 +1,444 @@
+/*
+ * This file is part of StructInt.
+ *
+ * StructInt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * StructInt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with StructInt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "serial.h"
+#include "arena.h"
+#include "batch.h"
+
+#include <string.h>
+
+#if PY_BIG_ENDIAN
+#define SERIAL_HOST_ORDER SERIAL_STATUS_BIG_ENDIAN
+#else
+#define SERIAL_HOST_ORDER 0
+#endif
+
+typedef struct {
+  uint8_t status;
+  uint32_t flags;
+  size_t bit_len;
+  size_t parts;
+  size_t count;
+} serial_header_t;
+
+static void serial_put_le(uint8_t *dst, uint64_t v, size_t sz) {
+  for (size_t i = 0; i < sz; ++i) {
+    dst[i] = (uint8_t)(v >> (8 * i));
+  }
+
+  return;
+}
+
+static uint64_t serial_get_le(const uint8_t *src, size_t sz) {
+  uint64_t v = 0LL;
+  for (size_t i = 0; i < sz; ++i) {
+    v |= (uint64_t)src[i] << (8 * i);
+  }
+
+  return v;
+}
+
+static uint8_t serial_status(structint_t *self) {
+  uint8_t status = SERIAL_HOST_ORDER;
+  status |= self->asymmetric ? SERIAL_STATUS_ASYMMETRIC : 0;
+  status |= self->carry ? SERIAL_STATUS_CARRY : 0;
+  status |= self->overflow ? SERIAL_STATUS_OVERFLOW : 0;
+  status |= self->null ? SERIAL_STATUS_NULL : 0;
+  return status;
+}
+
+static void serial_write_header(uint8_t *dst, const char *magic, uint8_t status, uint32_t flags, size_t bit_len) {
+  memcpy(dst, magic, 2);
+  dst[2] = SERIAL_VERSION;
+  dst[3] = status;
+  serial_put_le(dst + 4, flags, 4);
+  serial_put_le(dst + 8, bit_len, 8);
+  return;
+}
+
+/*
+ * checks magic, version and that 'len' bytes hold exactly header, status bytes (dumps_many only) 
+ * and all value parts
+ */
+static int serial_read_header(serial_header_t *h, const uint8_t *src, Py_ssize_t len, const char *magic, size_t header_sz) {
+  if ((len < (Py_ssize_t)header_sz) || memcmp(src, magic, 2)) {
+    PyErr_SetString(PyExc_ValueError, SERIAL_FORMAT_ERROR_STR);
+    return -1;
+  }
+
+  if (src[2] != SERIAL_VERSION) {
+    PyErr_Format(PyExc_ValueError, SERIAL_VERSION_ERROR_FMT, src[2]);
+    return -1;
+  }
+
+  h->status = src[3];
+  h->flags = (uint32_t)serial_get_le(src + 4, 4);
+  h->bit_len = serial_get_le(src + 8, 8);
+  h->count = (header_sz == SERIAL_MANY_HEADER_SZ) ? serial_get_le(src + 16, 8) : 1LL;
+
+  size_t data_sz = len - header_sz;
+  if (h->bit_len > data_sz * 8) {
+    PyErr_SetString(PyExc_ValueError, SERIAL_FORMAT_ERROR_STR);
+    return -1;
+  }
+
+  h->parts = get_uint64list_idx_by_bit(h->bit_len) + 1;
+  size_t item_sz = h->parts * 8 + ((header_sz == SERIAL_MANY_HEADER_SZ) ? 1 : 0);
+  if ((h->count > data_sz / item_sz) || (h->count * item_sz != data_sz)) {
+    PyErr_SetString(PyExc_ValueError, SERIAL_FORMAT_ERROR_STR);
+    return -1;
+  }
+
+  return 0;
+}
+
+static structint_t *serial_new_structint(PyTypeObject *type, structint_t *layout, batch_block_t *block, serial_header_t *h, uint8_t status, const uint8_t *src) {
+  structint_t *self = batch_new_structint(type, layout, block);
+  if (self == NULL) {
+    return NULL;
+  }
+
+  memcpy(self->value, src, h->parts * 8);
+  if ((status & SERIAL_STATUS_BIG_ENDIAN) != SERIAL_HOST_ORDER) {
+    for (size_t i = 0; i < h->parts; ++i) {
+      self->value[i] = uint64_bswap(self->value[i]);
+    }
+  }
+
+  if ((status & SERIAL_STATUS_NULL) || (h->bit_len == 0)) {
+    structint_set_null_value(self);
+  }
+  else {
+    structint_sign_smear(self);
+  }
+
+  return self;
+}
+
+static structint_t *serial_load_one(PyTypeObject *type, batch_block_t *block, serial_header_t *h, uint8_t status, const uint8_t *src) {
+  structint_t layout;
+  batch_set_layout(&layout, h->bit_len, h->flags);
+  layout.asymmetric = (status & SERIAL_STATUS_ASYMMETRIC) != 0;
+  layout.carry = (status & SERIAL_STATUS_CARRY) != 0;
+  layout.overflow = (status & SERIAL_STATUS_OVERFLOW) != 0;
+  return serial_new_structint(type, &layout, block, h, status, src);
+}
+
+
+int structint_getbuffer(structint_t *self, Py_buffer *view, int flags) {
+  int res = 0;
+  Py_BEGIN_CRITICAL_SECTION(self);
+  if (self->value == NULL) {
+    PyErr_SetString(PyExc_TypeError, SERIAL_VALUE_ERROR_STR);
+    res = -1;
+  }
+  // exported value can't move, so a value from an arena gets its own uint64list first
+  else if ((self->arena != NULL) && structint_arena_owns(self->arena, self->value)) {
+    size_t byte_sz;
+    uint64_t *value = copy_uint64list(NULL, NULL, self->byte_sz, self->value, self->byte_sz, &byte_sz);
+    if (value == NULL) {
+      PyErr_NoMemory();
+      res = -1;
+    }
+    else {
+      self->value = value;
+      self->byte_sz = byte_sz;
+      structint_arena_unlink(self);
+    }
+  }
+
+  if (res == 0) {
+    res = PyBuffer_FillInfo(view, (PyObject*)self, self->value, self->used_value_parts * 8, 1, flags);
+  }
+
+  if (res == 0) {
+    ++self->exports;
+  }
+  Py_END_CRITICAL_SECTION();
+
+  return res;
+}
+
+void structint_releasebuffer(structint_t *self, Py_buffer *Py_UNUSED(view)) {
+  Py_BEGIN_CRITICAL_SECTION(self);
+  --self->exports;
+  Py_END_CRITICAL_SECTION();
+  return;
+}
+
+PyObject *structint_reduce_ex(structint_t *self, PyObject *args) {
+  int protocol;
+  if (!PyArg_ParseTuple(args, "i", &protocol)) {
+    return NULL;
+  }
+
+  PyObject *module = structint_get_module((PyObject*)self);
+  if (module == NULL) {
+    return NULL;
+  }
+
+  // protocol 5 sends value parts out-of-band from the exported buffer, without copy.
+  // structint_getbuffer() rejects uninitialized values
+  PyObject *parts = NULL;
+  if (protocol >= 5) {
+    parts = PyPickleBuffer_FromObject((PyObject*)self);
+    if (parts == NULL) {
+      return NULL;
+    }
+  }
+
+  uint8_t header[SERIAL_HEADER_SZ];
+  bool initialized;
+  Py_BEGIN_CRITICAL_SECTION(self);
+  initialized = (self->value != NULL);
+  if (initialized) {
+    serial_write_header(header, SERIAL_MAGIC_ONE, serial_status(self), self->flags, self->bit_len);
+    if (parts == NULL) {
+      parts = PyBytes_FromStringAndSize((char*)self->value, self->used_value_parts * 8);
+    }
+  }
+  Py_END_CRITICAL_SECTION();
+
+  if (!initialized) {
+    Py_XDECREF(parts);
+    PyErr_SetString(PyExc_TypeError, SERIAL_VALUE_ERROR_STR);
+    return NULL;
+  }
+
+  // instances of subclasses keep their attributes as the pickle state
+  PyObject *dict = PyObject_GetAttrString((PyObject*)self, "__dict__");
+  if ((dict == NULL) && PyErr_ExceptionMatches(PyExc_AttributeError)) {
+    PyErr_Clear();
+  }
+
+  PyObject *restore = PyObject_GetAttrString(module, "_restore");
+  PyObject *header_obj = PyBytes_FromStringAndSize((char*)header, SERIAL_HEADER_SZ);
+  PyObject *res = NULL;
+  if ((parts != NULL) && (restore != NULL) && (header_obj != NULL) && !PyErr_Occurred()) {
+    if ((dict != NULL) && (PyObject_Length(dict) > 0)) {
+      res = Py_BuildValue("(O(OOO)O)", restore, Py_TYPE(self), header_obj, parts, dict);
+    }
+    else {
+      res = Py_BuildValue("(O(OOO))", restore, Py_TYPE(self), header_obj, parts);
+    }
+  }
+
+  Py_XDECREF(dict);
+  Py_XDECREF(parts);
+  Py_XDECREF(restore);
+  Py_XDECREF(header_obj);
+  return res;
+}
+
+
+PyObject *structint_restore(PyObject *module, PyObject *args) {
+  PyObject *arg_cls, *arg_header, *arg_parts;
+  if (!PyArg_ParseTuple(args, "OOO", &arg_cls, &arg_header, &arg_parts)) {
+    return NULL;
+  }
+
+  structint_state *state = structint_get_module_state(module);
+  if (!PyType_Check(arg_cls) || !PyType_IsSubtype((PyTypeObject*)arg_cls, state->structint_Type)) {
+    PyErr_SetString(PyExc_TypeError, SERIAL_CLASS_ERROR_STR);
+    return NULL;
+  }
+
+  Py_buffer header, parts;
+  if (PyObject_GetBuffer(arg_header, &header, PyBUF_SIMPLE)) {
+    return NULL;
+  }
+
+  if (PyObject_GetBuffer(arg_parts, &parts, PyBUF_SIMPLE)) {
+    PyBuffer_Release(&header);
+    return NULL;
+  }
+
+  // header and parts are checked together like one dumps() buffer
+  PyObject *res = NULL;
+  serial_header_t h;
+  if (header.len != SERIAL_HEADER_SZ) {
+    PyErr_SetString(PyExc_ValueError, SERIAL_FORMAT_ERROR_STR);
+  }
+  else if (!serial_read_header(&h, header.buf, SERIAL_HEADER_SZ + parts.len, SERIAL_MAGIC_ONE, SERIAL_HEADER_SZ)) {
+    res = (PyObject*)serial_load_one((PyTypeObject*)arg_cls, NULL, &h, h.status, parts.buf);
+  }
+
+  PyBuffer_Release(&header);
+  PyBuffer_Release(&parts);
+  return res;
+}
+
+PyObject *structint_dumps(PyObject *module, PyObject *arg) {
+  structint_state *state = structint_get_module_state(module);
+  if (!structint_type_check(state, arg)) {
+    PyErr_SetString(PyExc_TypeError, SERIAL_VALUE_ERROR_STR);
+    return NULL;
+  }
+
+  structint_t *self = (structint_t*)arg;
+  PyObject *res = NULL;
+  Py_BEGIN_CRITICAL_SECTION(self);
+  size_t parts_sz = self->used_value_parts * 8;
+  if (self->value == NULL) {
+    PyErr_SetString(PyExc_TypeError, SERIAL_VALUE_ERROR_STR);
+  }
+  else {
+    res = PyBytes_FromStringAndSize(NULL, SERIAL_HEADER_SZ + parts_sz);
+  }
+
+  if (res != NULL) {
+    uint8_t *dst = (uint8_t*)PyBytes_AS_STRING(res);
+    serial_write_header(dst, SERIAL_MAGIC_ONE, serial_status(self), self->flags, self->bit_len);
+    memcpy(dst + SERIAL_HEADER_SZ, self->value, parts_sz);
+  }
+  Py_END_CRITICAL_SECTION();
+
+  return res;
+}
+
+PyObject *structint_loads(PyObject *module, PyObject *arg) {
+  structint_state *state = structint_get_module_state(module);
+  Py_buffer buf;
+  if (PyObject_GetBuffer(arg, &buf, PyBUF_SIMPLE)) {
+    return NULL;
+  }
+
+  PyObject *res = NULL;
+  serial_header_t h;
+  if (!serial_read_header(&h, buf.buf, buf.len, SERIAL_MAGIC_ONE, SERIAL_HEADER_SZ)) {
+    res = (PyObject*)serial_load_one(state->structint_Type, NULL, &h, h.status, (uint8_t*)buf.buf + SERIAL_HEADER_SZ);
+  }
+
+  PyBuffer_Release(&buf);
+  return res;
+}
+
+PyObject *structint_dumps_many(PyObject *module, PyObject *arg) {
+  structint_state *state = structint_get_module_state(module);
+  PyObject *seq = PySequence_Fast(arg, "argument must be iterable");
+  if (seq == NULL) {
+    return NULL;
+  }
+
+  Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+  PyObject **items = PySequence_Fast_ITEMS(seq);
+  for (Py_ssize_t i = 0; i < count; ++i) {
+    if (!structint_type_check(state, items[i])) {
+      Py_DECREF(seq);
+      PyErr_SetString(PyExc_TypeError, SERIAL_VALUE_ERROR_STR);
+      return NULL;
+    }
+  }
+
+  // layout comes from the first value, every other value must match it
+  size_t bit_len = 0LL;
+  uint32_t flags = 0;
+  if (count > 0) {
+    structint_t *first = (structint_t*)items[0];
+    Py_BEGIN_CRITICAL_SECTION(first);
+    bit_len = first->bit_len;
+    flags = first->flags;
+    Py_END_CRITICAL_SECTION();
+  }
+
+  size_t parts_sz = (get_uint64list_idx_by_bit(bit_len) + 1) * 8;
+  PyObject *res = PyBytes_FromStringAndSize(NULL, SERIAL_MANY_HEADER_SZ + count * (parts_sz + 1));
+  if (res == NULL) {
+    Py_DECREF(seq);
+    return NULL;
+  }
+
+  uint8_t *dst = (uint8_t*)PyBytes_AS_STRING(res);
+  serial_write_header(dst, SERIAL_MAGIC_MANY, SERIAL_HOST_ORDER, flags, bit_len);
+  serial_put_le(dst + 16, count, 8);
+  uint8_t *status = dst + SERIAL_MANY_HEADER_SZ;
+  dst = status + count;
+
+  bool initialized = true, match = true;
+  for (Py_ssize_t i = 0; (i < count) && initialized && match; ++i) {
+    structint_t *self = (structint_t*)items[i];
+    Py_BEGIN_CRITICAL_SECTION(self);
+    initialized = (self->value != NULL);
+    match = (self->bit_len == bit_len) && (self->flags == flags);
+    if (initialized && match) {
+      status[i] = serial_status(self) & ~SERIAL_STATUS_BIG_ENDIAN;
+      memcpy(dst + i * parts_sz, self->value, parts_sz);
+    }
+    Py_END_CRITICAL_SECTION();
+  }
+
+  Py_DECREF(seq);
+  if (!initialized) {
+    Py_DECREF(res);
+    PyErr_SetString(PyExc_TypeError, SERIAL_VALUE_ERROR_STR);
+    return NULL;
+  }
+
+  if (!match) {
+    Py_DECREF(res);
+    PyErr_SetString(PyExc_ValueError, SERIAL_LAYOUT_ERROR_STR);
+    return NULL;
+  }
+
+  return res;
+}
+
+PyObject *structint_loads_many(PyObject *module, PyObject *arg) {
+  structint_state *state = structint_get_module_state(module);
+  Py_buffer buf;
+  if (PyObject_GetBuffer(arg, &buf, PyBUF_SIMPLE)) {
+    return NULL;
+  }
+
+  serial_header_t h;
+  if (serial_read_header(&h, buf.buf, buf.len, SERIAL_MAGIC_MANY, SERIAL_MANY_HEADER_SZ)) {
+    PyBuffer_Release(&buf);
+    return NULL;
+  }
+
+  PyObject *res = PyList_New(h.count);
+  if (res == NULL) {
+    PyBuffer_Release(&buf);
+    return NULL;
+  }
+
+  structint_t layout;
+  batch_block_t block;
+  batch_set_layout(&layout, h.bit_len, h.flags);
+  if (batch_alloc_block(&block, &layout, h.count) == NULL) {
+    PyBuffer_Release(&buf);
+    Py_DECREF(res);
+    return NULL;
+  }
+
+  const uint8_t *status = (uint8_t*)buf.buf + SERIAL_MANY_HEADER_SZ;
+  const uint8_t *src = status + h.count;
+  for (size_t i = 0; i < h.count; ++i) {
+    uint8_t value_status = (h.status & SERIAL_STATUS_BIG_ENDIAN) | status[i];
+    structint_t *self = serial_load_one(state->structint_Type, &block, &h, value_status, src + i * h.parts * 8);
+    if (self == NULL) {
+      batch_dealloc_block(&block);
+      Py_CLEAR(res);
+      break;
+    }
+
+    PyList_SET_ITEM(res, i, (PyObject*)self);
+  }
+
+  PyBuffer_Release(&buf);
+  return res;
+}
@@ -0,0 +1,67 @@
+/*
+ * This file is part of StructInt.
+ *
+ * StructInt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * StructInt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with StructInt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "core.h"
+
+#define DUMPS_DOCSTR "dumps(value)\n\nbytes with header (len, flags, status) and normalized value parts of a structint"
+#define LOADS_DOCSTR "loads(buf)\n\nstructint from bytes made by dumps()"
+#define DUMPS_MANY_DOCSTR "dumps_many(iterable)\n\nbytes with one header and value parts of structints which all have the same len and flags. Status flags are stored for every value"
+#define LOADS_MANY_DOCSTR "loads_many(buf)\n\nlist of structints from bytes made by dumps_many()"
+#define RESTORE_DOCSTR "_restore(cls, header, parts)\n\npickle support, use loads() instead"
+
+/*
+ * Serialized structint:
+ *   0  2 bytes magic "SI" ("SM" for dumps_many)
+ *   2  1 byte  version
+ *   3  1 byte  status bits
+ *   4  4 bytes flags (little endian)
+ *   8  8 bytes bit_len (little endian)
+ *  16  8 bytes count of values (little endian, dumps_many only)
+ *  24  1 byte  status bits of every value (dumps_many only, without SERIAL_STATUS_BIG_ENDIAN)
+ * followed by used_value_parts uint64 parts of every value, in host byte order marked by
+ * SERIAL_STATUS_BIG_ENDIAN, so pickle protocol 5 can send them out-of-band straight from 
+ * the exported buffer of structint
+ */
+#define SERIAL_MAGIC_ONE "SI"
+#define SERIAL_MAGIC_MANY "SM"
+#define SERIAL_VERSION 1
+#define SERIAL_HEADER_SZ 16
+#define SERIAL_MANY_HEADER_SZ 24
+
+#define SERIAL_STATUS_ASYMMETRIC 0x01
+#define SERIAL_STATUS_CARRY      0x02
+#define SERIAL_STATUS_OVERFLOW   0x04
+#define SERIAL_STATUS_NULL       0x08
+#define SERIAL_STATUS_BIG_ENDIAN 0x80
+
+#define SERIAL_FORMAT_ERROR_STR "buffer isn't a serialized structint"
+#define SERIAL_VERSION_ERROR_FMT "unsupported structint serialization version %d"
+#define SERIAL_LAYOUT_ERROR_STR "dumps_many() requires the same len and flags for all values"
+#define SERIAL_CLASS_ERROR_STR "first argument must be structint or its subclass"
+#define SERIAL_VALUE_ERROR_STR "only initialized structint objects can be serialized"
+#define SERIAL_EXPORTS_ERROR_STR "structint with exported buffer can't be modified"
+
+PyObject *structint_reduce_ex(structint_t *self, PyObject *args);
+int structint_getbuffer(structint_t *self, Py_buffer *view, int flags);
+void structint_releasebuffer(structint_t *self, Py_buffer *view);
+
+PyObject *structint_dumps(PyObject *module, PyObject *arg);
+PyObject *structint_loads(PyObject *module, PyObject *arg);
+PyObject *structint_dumps_many(PyObject *module, PyObject *arg);
+PyObject *structint_loads_many(PyObject *module, PyObject *arg);
+PyObject *structint_restore(PyObject *module, PyObject *args);
@@ -0,0 +1,232 @@
+/*
+ * This file is part of StructInt.
+ *
+ * StructInt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * StructInt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with StructInt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "stats.h"
+
+#ifdef STRUCTINT_STATS
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define STATS_CLOCK_NAME "tsc"
+#define stats_atomic_add(ptr, n) _InterlockedExchangeAdd64((volatile __int64*)(ptr), (__int64)(n))
+#define stats_atomic_load(ptr) ((uint64_t)_InterlockedOr64((volatile __int64*)(ptr), 0))
+#define stats_atomic_store(ptr, n) _InterlockedExchange64((volatile __int64*)(ptr), (__int64)(n))
+#else
+#define stats_atomic_add(ptr, n) __atomic_fetch_add(ptr, n, __ATOMIC_RELAXED)
+#define stats_atomic_load(ptr) __atomic_load_n(ptr, __ATOMIC_RELAXED)
+#define stats_atomic_store(ptr, n) __atomic_store_n(ptr, n, __ATOMIC_RELAXED)
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define STATS_CLOCK_NAME "tsc"
+#else
+#include <time.h>
+#define STATS_CLOCK_NAME "ns"
+#endif
+#endif
+
+#ifdef STRUCTINT_USDT
+#include <sys/sdt.h>
+#define stats_probe_op(op_id, parts, cycles) DTRACE_PROBE3(structint, op, op_id, parts, cycles)
+#define stats_probe_alloc(kind_id, new_sz, old_sz) DTRACE_PROBE3(structint, alloc, kind_id, new_sz, old_sz)
+#else
+#define stats_probe_op(op_id, parts, cycles)
+#define stats_probe_alloc(kind_id, new_sz, old_sz)
+#endif
+
+structint_stats_t structint_stats_counters;
+
+uint64_t structint_stats_clock(void) {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+static size_t stats_parts_bucket(size_t parts) {
+  size_t bucket = 0;
+  while ((bucket < STATS_PARTS_BUCKETS - 1) && (((size_t)1 << bucket) < parts)) {
+    ++bucket;
+  }
+
+  return bucket;
+}
+
+void structint_stats_op(stats_op_t op, size_t parts, uint64_t start) {
+  uint64_t cycles = structint_stats_clock() - start;
+  stats_atomic_add(&structint_stats_counters.op_calls[op], 1);
+  stats_atomic_add(&structint_stats_counters.op_cycles[op], cycles);
+  stats_atomic_add(&structint_stats_counters.parts_histogram[op][stats_parts_bucket(parts)], 1);
+  stats_probe_op((int)op, parts, cycles);
+  return;
+}
+
+void structint_stats_alloc(stats_alloc_t kind, size_t new_sz, size_t old_sz) {
+  stats_atomic_add(&structint_stats_counters.allocs[kind], 1);
+  stats_probe_alloc((int)kind, new_sz, old_sz);
+  return;
+}
+
+void structint_stats_converted(structint_obj_t type, size_t byte_sz) {
+  stats_atomic_add(&structint_stats_counters.converted_values[type], 1);
+  stats_atomic_add(&structint_stats_counters.converted_bytes[type], byte_sz);
+  return;
+}
+
+
+static const char *stats_op_names[StatsOpCount] = {
+  "init", "convert", "from_ints", "from_buffer_many", "expr", "snapshot"
+};
+
+static const char *stats_alloc_names[StatsAllocCount] = {
+  "malloc", "realloc", "reuse", "arena", "block", "free"
+};
+
+// in order of structint_obj_t, TypeError is never counted
+static const char *stats_obj_names[STATS_OBJ_TYPES] = {
+  NULL, "int", "structint", "bytearray", "bytes", "bool", "none"
+};
+
+static int stats_set_u64(PyObject *dict, const char *key, uint64_t *counter) {
+  PyObject *value = PyLong_FromUnsignedLongLong(stats_atomic_load(counter));
+  if (value == NULL) {
+    return -1;
+  }
+
+  int err = PyDict_SetItemString(dict, key, value);
+  Py_DECREF(value);
+  return err;
+}
+
+static PyObject *stats_build_histogram(uint64_t *buckets) {
+  PyObject *res = PyDict_New();
+  if (res == NULL) {
+    return NULL;
+  }
+
+  for (size_t i = 0; i < STATS_PARTS_BUCKETS; ++i) {
+    uint64_t count = stats_atomic_load(&buckets[i]);
+    if (count == 0) {
+      continue;
+    }
+
+    PyObject *key = PyLong_FromSize_t((size_t)1 << i);
+    PyObject *value = PyLong_FromUnsignedLongLong(count);
+    int err = (key == NULL) || (value == NULL) || PyDict_SetItem(res, key, value);
+    Py_XDECREF(key);
+    Py_XDECREF(value);
+    if (err) {
+      Py_DECREF(res);
+      return NULL;
+    }
+  }
+
+  return res;
+}
+
+static PyObject *stats_build(void) {
+  structint_stats_t *c = &structint_stats_counters;
+  PyObject *res = Py_BuildValue("{s:O,s:s}", "enabled", Py_True, "clock", STATS_CLOCK_NAME);
+  PyObject *ops = PyDict_New();
+  PyObject *allocs = PyDict_New();
+  PyObject *converted = PyDict_New();
+  if ((res == NULL) || (ops == NULL) || (allocs == NULL) || (converted == NULL)) {
+    goto error;
+  }
+
+  for (size_t i = 0; i < StatsOpCount; ++i) {
+    PyObject *op = PyDict_New();
+    if ((op == NULL) || PyDict_SetItemString(ops, stats_op_names[i], op)) {
+      Py_XDECREF(op);
+      goto error;
+    }
+
+    Py_DECREF(op);
+    if (stats_set_u64(op, "calls", &c->op_calls[i]) || stats_set_u64(op, "cycles", &c->op_cycles[i])) {
+      goto error;
+    }
+
+    PyObject *histogram = stats_build_histogram(c->parts_histogram[i]);
+    int err = (histogram == NULL) || PyDict_SetItemString(op, "parts_histogram", histogram);
+    Py_XDECREF(histogram);
+    if (err) {
+      goto error;
+    }
+  }
+
+  for (size_t i = 0; i < StatsAllocCount; ++i) {
+    if (stats_set_u64(allocs, stats_alloc_names[i], &c->allocs[i])) {
+      goto error;
+    }
+  }
+
+  for (size_t i = 1; i < STATS_OBJ_TYPES; ++i) {
+    PyObject *type = PyDict_New();
+    if ((type == NULL) || PyDict_SetItemString(converted, stats_obj_names[i], type)) {
+      Py_XDECREF(type);
+      goto error;
+    }
+
+    Py_DECREF(type);
+    if (stats_set_u64(type, "values", &c->converted_values[i]) || stats_set_u64(type, "bytes", &c->converted_bytes[i])) {
+      goto error;
+    }
+  }
+
+  if (PyDict_SetItemString(res, "ops", ops) || PyDict_SetItemString(res, "alloc", allocs) || PyDict_SetItemString(res, "converted", converted)) {
+    goto error;
+  }
+
+  Py_DECREF(ops);
+  Py_DECREF(allocs);
+  Py_DECREF(converted);
+  return res;
+
+error:
+  Py_XDECREF(res);
+  Py_XDECREF(ops);
+  Py_XDECREF(allocs);
+  Py_XDECREF(converted);
+  return NULL;
+}
+
+PyObject *structint_stats(PyObject *module, PyObject *Py_UNUSED(ignored)) {
+  return stats_build();
+}
+
+PyObject *structint_reset_stats(PyObject *module, PyObject *Py_UNUSED(ignored)) {
+  uint64_t *counters = (uint64_t*)&structint_stats_counters;
+  for (size_t i = 0; i < sizeof(structint_stats_t) / sizeof(uint64_t); ++i) {
+    stats_atomic_store(&counters[i], 0);
+  }
+
+  Py_RETURN_NONE;
+}
+
+#else
+
+PyObject *structint_stats(PyObject *module, PyObject *Py_UNUSED(ignored)) {
+  return Py_BuildValue("{s:O}", "enabled", Py_False);
+}
+
+PyObject *structint_reset_stats(PyObject *module, PyObject *Py_UNUSED(ignored)) {
+  Py_RETURN_NONE;
+}
+
+#endif
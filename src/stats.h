@@ -0,0 +1,92 @@
+/*
+ * This file is part of StructInt.
+ *
+ * StructInt is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * StructInt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with StructInt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "core.h"
+
+#define STATS_DOCSTR "stats()\n\ndict with operation, allocation and conversion counters. Counters exist only in builds with STRUCTINT_STATS, otherwise the dict is {'enabled': False}"
+#define RESET_STATS_DOCSTR "reset_stats()\n\nset all counters to zero"
+
+/*
+ * Performance counters are compiled only with STRUCTINT_STATS defined (see structint_setup.py),
+ * otherwise all stats_* macros expand to nothing. With STRUCTINT_USDT the same events are also
+ * emitted as USDT probes (provider structint, probes op and alloc).
+ * Counters are process-wide and updated with relaxed atomics, so values from different 
+ * threads and subinterpreters are summed together.
+ * Operations can nest (init converts its argument), so cycles of an operation include its 
+ * nested operations and every operation has its own parts histogram.
+ * Operations are counted only when they succeed, converted bytes are the size of the source value
+ */
+typedef enum {
+  StatsOpInit,
+  StatsOpConvert,
+  StatsOpFromInts,
+  StatsOpFromBufferMany,
+  StatsOpExpr,
+  StatsOpSnapshot,
+  StatsOpCount
+} stats_op_t;
+
+typedef enum {
+  StatsAllocMalloc,
+  StatsAllocRealloc,
+  StatsAllocReuse,
+  StatsAllocArena,
+  StatsAllocBlock,
+  StatsAllocFree,
+  StatsAllocCount
+} stats_alloc_t;
+
+// used_value_parts histogram, bucket k counts values with (2^(k-1), 2^k] parts
+#define STATS_PARTS_BUCKETS 32
+// indexed by structint_obj_t
+#define STATS_OBJ_TYPES 7
+
+PyObject *structint_stats(PyObject *module, PyObject *Py_UNUSED(ignored));
+PyObject *structint_reset_stats(PyObject *module, PyObject *Py_UNUSED(ignored));
+
+#ifdef STRUCTINT_STATS
+
+typedef struct {
+  uint64_t op_calls[StatsOpCount];
+  uint64_t op_cycles[StatsOpCount];
+  uint64_t parts_histogram[StatsOpCount][STATS_PARTS_BUCKETS];
+  uint64_t allocs[StatsAllocCount];
+  uint64_t converted_values[STATS_OBJ_TYPES];
+  uint64_t converted_bytes[STATS_OBJ_TYPES];
+} structint_stats_t;
+
+extern structint_stats_t structint_stats_counters;
+
+uint64_t structint_stats_clock(void);
+void structint_stats_op(stats_op_t op, size_t parts, uint64_t start);
+void structint_stats_alloc(stats_alloc_t kind, size_t new_sz, size_t old_sz);
+void structint_stats_converted(structint_obj_t type, size_t byte_sz);
+
+#define stats_op_begin() uint64_t stats_op_start = structint_stats_clock()
+#define stats_op_end(op, parts) structint_stats_op(op, parts, stats_op_start)
+#define stats_alloc(kind, new_sz, old_sz) structint_stats_alloc(kind, new_sz, old_sz)
+#define stats_converted(type, byte_sz) structint_stats_converted(type, byte_sz)
+
+#else
+
+#define stats_op_begin()
+#define stats_op_end(op, parts)
+#define stats_alloc(kind, new_sz, old_sz)
+#define stats_converted(type, byte_sz)
+
+#endif
@@ -18,8 +18,14 @@
 #include "structint.h"
 
 void structint_dealloc(structint_t *self) {
-  dealloc_uint64list(self->value);
-  Py_TYPE(self)->tp_free((PyObject*)self);
+  PyTypeObject *type = Py_TYPE(self);
+  // unlink first, promotion in another thread can still replace the value
+  if (!structint_arena_unlink(self)) {
+    dealloc_uint64list(NULL, self->value);
+  }
+
+  type->tp_free((PyObject*)self);
+  Py_DECREF(type);
   return;
 }
 
@@ -41,10 +47,52 @@ PyObject *structint_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
   self->carry = 0;
   self->overflow = 0;
   self->null = 0;
+  self->exports = 0;
+
+  self->arena = NULL;
+  self->arena_prev = NULL;
+  self->arena_next = NULL;
+  structint_arena_t *arena = structint_arena_current();
+  if (arena != NULL) {
+    structint_arena_link(arena, self);
+  }
 
   return (PyObject*)self;
 }
 
+static int structint_check_exports(structint_t *self) {
+  if (self->exports > 0) {
+    PyErr_SetString(PyExc_BufferError, SERIAL_EXPORTS_ERROR_STR);
+    return -1;
+  }
+
+  return 0;
+}
+
+static int structint_init_copy(structint_t *self, structint_t *src, size_t arg_bit_len, uint32_t arg_flags) {
+  if (structint_check_exports(self)) {
+    return -1;
+  }
+
+  stats_converted(StructInt, src->used_value_parts * 8);
+  size_t res_sz, dst_sz = get_uint64list_bytesz_from_bitlen(arg_bit_len);
+  uint64_t *value = copy_uint64list(self->arena, NULL, dst_sz, src->value, src->byte_sz, &res_sz);
+  if (value == NULL) {
+    PyErr_NoMemory();
+    return -1;
+  }
+
+  if (structint_unsafe_copy(self, src) == NULL) {
+    return -1;
+  }
+
+  if (structint_safe_set_all(self, value, res_sz, arg_bit_len, arg_flags) == NULL) {
+    return -1;
+  }
+
+  return 0;
+}
+
 int structint_init(structint_t *self, PyObject *args, PyObject *kwds) {
   static char *kwlist[] = {"value", "len", "flags", NULL};
   PyObject *arg_obj = Py_None;
@@ -57,49 +105,123 @@ int structint_init(structint_t *self, PyObject *args, PyObject *kwds) {
     return -1;
   }
 
-  if (structint_type_check(arg_obj)) {
-    structint_t *src = (structint_t*)arg_obj;
-    size_t res_sz, dst_sz = get_uint64list_bytesz_from_bitlen(arg_bit_len);
-    uint64_t *value = copy_uint64list(NULL, dst_sz, src->value, src->byte_sz, &res_sz);
-    if (value == NULL) {
-      PyErr_NoMemory();
-      return -1;
-    }
-
-    if (structint_unsafe_copy(self, src) == NULL) {
-      return -1;
-    }
+  structint_state *state = structint_get_state((PyObject*)self);
+  if (state == NULL) {
+    return -1;
+  }
 
-    if (structint_safe_set_all(self, value, res_sz, arg_bit_len, arg_flags) == NULL) {
-      return -1;
-    }
+  stats_op_begin();
+  int res = 0;
+  if (structint_type_check(state, arg_obj)) {
+    Py_BEGIN_CRITICAL_SECTION2(self, arg_obj);
+    res = structint_init_copy(self, (structint_t*)arg_obj, arg_bit_len, arg_flags);
+    Py_END_CRITICAL_SECTION2();
   }
   else {
-    self->bit_len = (arg_bit_len == -1) ? 0 : arg_bit_len;
-    self->flags = (arg_flags == -1) ? 0 : arg_flags;
-    if (structint_convert_obj_and_selfstore(self, arg_obj) == NULL) {
-      return -1;
+    Py_BEGIN_CRITICAL_SECTION(self);
+    res = structint_check_exports(self);
+    if (res == 0) {
+      self->bit_len = (arg_bit_len == -1) ? 0 : arg_bit_len;
+      self->flags = (arg_flags == -1) ? 0 : arg_flags;
+      if (structint_convert_obj_and_selfstore(self, arg_obj) == NULL) {
+        res = -1;
+      }
     }
+    Py_END_CRITICAL_SECTION();
+  }
+
+  if (res == 0) {
+    stats_op_end(StatsOpInit, self->used_value_parts);
   }
 
+  return res;
+}
+
+PyObject *structint_get_carry(structint_t *self, void *Py_UNUSED(closure)) {
+  char carry;
+  Py_BEGIN_CRITICAL_SECTION(self);
+  carry = self->carry;
+  Py_END_CRITICAL_SECTION();
+
+  return PyBool_FromLong(carry);
+}
+
+int structint_set_carry(structint_t *self, PyObject *value, void *Py_UNUSED(closure)) {
+  if (value == NULL) {
+    PyErr_SetString(PyExc_TypeError, "can't delete carry attribute");
+    return -1;
+  }
+
+  if (!PyBool_Check(value)) {
+    PyErr_SetString(PyExc_TypeError, "attribute value type must be bool");
+    return -1;
+  }
+
+  Py_BEGIN_CRITICAL_SECTION(self);
+  self->carry = (value == Py_True);
+  Py_END_CRITICAL_SECTION();
+
   return 0;
 }
 
 
-PyMODINIT_FUNC PyInit_structint(void) {
-  PyObject *m;
-  if (PyType_Ready(&structint_Type) < 0) {
-    return NULL;
+structint_state *structint_get_module_state(PyObject *module) {
+  return (structint_state*)PyModule_GetState(module);
+}
+
+PyObject *structint_get_module(PyObject *obj) {
+#if PY_VERSION_HEX >= 0x030B0000
+  return PyType_GetModuleByDef(Py_TYPE(obj), &module_structint);
+#else
+  // PyType_GetModuleByDef() is new in 3.11, subclasses are searched the same way through tp_base
+  for (PyTypeObject *type = Py_TYPE(obj); type != NULL; type = type->tp_base) {
+    if (PyType_HasFeature(type, Py_TPFLAGS_HEAPTYPE)) {
+      PyObject *m = ((PyHeapTypeObject*)type)->ht_module;
+      if ((m != NULL) && (PyModule_GetDef(m) == &module_structint)) {
+        return m;
+      }
+    }
   }
 
-  m = PyModule_Create(&module_structint);
+  PyErr_Format(PyExc_TypeError, "no superclass of '%s' belongs to structint module", Py_TYPE(obj)->tp_name);
+  return NULL;
+#endif
+}
+
+structint_state *structint_get_state(PyObject *obj) {
+  PyObject *m = structint_get_module(obj);
   if (m == NULL) {
     return NULL;
   }
 
-  Py_INCREF(&structint_Type);
+  return structint_get_module_state(m);
+}
+
+
+int structint_module_exec(PyObject *m) {
+  structint_state *state = structint_get_module_state(m);
+
+  state->structint_Type = (PyTypeObject*)PyType_FromModuleAndSpec(m, &structint_spec, NULL);
+  if (state->structint_Type == NULL) {
+    return -1;
+  }
+
   int m_err = 0;
-  m_err |= PyModule_AddObject(m, "structint", (PyObject*)&structint_Type);
+  m_err |= PyModule_AddType(m, state->structint_Type);
+
+  state->arena_Type = (PyTypeObject*)PyType_FromModuleAndSpec(m, &structint_arena_spec, NULL);
+  if (state->arena_Type == NULL) {
+    return -1;
+  }
+
+  m_err |= PyModule_AddType(m, state->arena_Type);
+
+  state->expr_Type = (PyTypeObject*)PyType_FromModuleAndSpec(m, &structint_expr_spec, NULL);
+  if (state->expr_Type == NULL) {
+    return -1;
+  }
+
+  m_err |= PyModule_AddType(m, state->expr_Type);
   
   m_err |= PyModule_AddIntConstant(m, "UNSIGNED", STRUCTINT_FLAGS_UNSIGNED);
   m_err |= PyModule_AddIntConstant(m, "ASYMMETRIC_LEN", STRUCTINT_FLAGS_ASYMMETRIC_LEN);
@@ -110,19 +232,46 @@ PyMODINIT_FUNC PyInit_structint(void) {
   m_err |= PyModule_AddIntConstant(m, "OVERFLOW_EXCEPTION", STRUCTINT_FLAGS_OVERFLOW_EXCEPTION);
   m_err |= PyModule_AddIntConstant(m, "NULL_IS_NOT_ZERO", STRUCTINT_FLAGS_NULL_IS_NOT_ZERO);
 
-  structintExc_AsymmetricError = PyErr_NewException("structint.AsymmetricError", NULL, NULL);
-  m_err |= PyModule_AddObject(m, "AsymmetricError", structintExc_AsymmetricError);
+  state->AsymmetricError = PyErr_NewException("structint.AsymmetricError", NULL, NULL);
+  m_err |= PyModule_AddObjectRef(m, "AsymmetricError", state->AsymmetricError);
   
-  structintExc_CarryError = PyErr_NewException("structint.CarryError", NULL, NULL);
-  m_err |= PyModule_AddObject(m, "CarryError", structintExc_CarryError);
+  state->CarryError = PyErr_NewException("structint.CarryError", NULL, NULL);
+  m_err |= PyModule_AddObjectRef(m, "CarryError", state->CarryError);
   
-  structintExc_NullError = PyErr_NewException("structint.NullError", NULL, NULL);
-  m_err |= PyModule_AddObject(m, "NullError", structintExc_NullError);
+  state->NullError = PyErr_NewException("structint.NullError", NULL, NULL);
+  m_err |= PyModule_AddObjectRef(m, "NullError", state->NullError);
 
-  if (m_err == -1) {
-    Py_DECREF(&structint_Type);
-    Py_DECREF(m);
-  } 
+  return m_err;
+}
 
-  return m;
+int structint_module_traverse(PyObject *m, visitproc visit, void *arg) {
+  structint_state *state = structint_get_module_state(m);
+  Py_VISIT(state->structint_Type);
+  Py_VISIT(state->arena_Type);
+  Py_VISIT(state->expr_Type);
+  Py_VISIT(state->AsymmetricError);
+  Py_VISIT(state->CarryError);
+  Py_VISIT(state->NullError);
+  return 0;
+}
+
+int structint_module_clear(PyObject *m) {
+  structint_state *state = structint_get_module_state(m);
+  Py_CLEAR(state->structint_Type);
+  Py_CLEAR(state->arena_Type);
+  Py_CLEAR(state->expr_Type);
+  Py_CLEAR(state->AsymmetricError);
+  Py_CLEAR(state->CarryError);
+  Py_CLEAR(state->NullError);
+  return 0;
+}
+
+void structint_module_free(void *m) {
+  structint_module_clear((PyObject*)m);
+  return;
+}
+
+
+PyMODINIT_FUNC PyInit_structint(void) {
+  return PyModuleDef_Init(&module_structint);
 }
@@ -21,6 +21,11 @@
 #include "structmember.h"
 
 #include "core.h"
+#include "batch.h"
+#include "arena.h"
+#include "expr.h"
+#include "stats.h"
+#include "serial.h"
 
 #include <stdbool.h>
 #include <stdint.h>
@@ -32,7 +37,6 @@ static PyMemberDef structint_members[] = {
   {"len", T_ULONGLONG, offsetof(structint_t, bit_len), READONLY},
   {"flags", T_UINT, offsetof(structint_t, flags), READONLY},
   {"asymmetric", T_BOOL, offsetof(structint_t, asymmetric), READONLY},
-  {"carry", T_BOOL, offsetof(structint_t, carry), 0},
   {"overflow", T_BOOL, offsetof(structint_t, overflow), READONLY},
   {"null", T_BOOL, offsetof(structint_t, null), READONLY},
   {"test_byte_sz", T_ULONGLONG, offsetof(structint_t, byte_sz), READONLY},
@@ -41,31 +45,84 @@ static PyMemberDef structint_members[] = {
   {NULL}
 };
 
+/* 
+ * carry is the only writable member, so it goes through getset to take the critical section
+ */
+PyObject *structint_get_carry(structint_t *self, void *Py_UNUSED(closure));
+int structint_set_carry(structint_t *self, PyObject *value, void *Py_UNUSED(closure));
+
+static PyGetSetDef structint_getset[] = {
+  {"carry", (getter)structint_get_carry, (setter)structint_set_carry},
+  {NULL}
+};
+
 static PyMethodDef structint_methods[] = {
   {"print_value", (PyCFunction)structint_print_value, METH_NOARGS},
+  {"__reduce_ex__", (PyCFunction)structint_reduce_ex, METH_VARARGS},
+  {NULL}
+};
+
+static PyType_Slot structint_slots[] = {
+  {Py_tp_doc, PyDoc_STR(STRUCTINT_DOCSTR)},
+  {Py_tp_new, structint_new},
+  {Py_tp_init, structint_init},
+  {Py_tp_dealloc, structint_dealloc},
+  {Py_tp_members, structint_members},
+  {Py_tp_getset, structint_getset},
+  {Py_tp_methods, structint_methods},
+  {Py_bf_getbuffer, structint_getbuffer},
+  {Py_bf_releasebuffer, structint_releasebuffer},
+  {0, NULL}
+};
+
+static PyType_Spec structint_spec = {
+  .name = "structint.structint",
+  .basicsize = sizeof(structint_t),
+  .itemsize = 0,
+  .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+  .slots = structint_slots,
+};
+
+static PyMethodDef structint_module_methods[] = {
+  {"from_ints", (PyCFunction)structint_from_ints, METH_VARARGS | METH_KEYWORDS, PyDoc_STR(FROM_INTS_DOCSTR)},
+  {"from_buffer_many", (PyCFunction)structint_from_buffer_many, METH_VARARGS | METH_KEYWORDS, PyDoc_STR(FROM_BUFFER_MANY_DOCSTR)},
+  {"stats", (PyCFunction)structint_stats, METH_NOARGS, PyDoc_STR(STATS_DOCSTR)},
+  {"reset_stats", (PyCFunction)structint_reset_stats, METH_NOARGS, PyDoc_STR(RESET_STATS_DOCSTR)},
+  {"dumps", (PyCFunction)structint_dumps, METH_O, PyDoc_STR(DUMPS_DOCSTR)},
+  {"loads", (PyCFunction)structint_loads, METH_O, PyDoc_STR(LOADS_DOCSTR)},
+  {"dumps_many", (PyCFunction)structint_dumps_many, METH_O, PyDoc_STR(DUMPS_MANY_DOCSTR)},
+  {"loads_many", (PyCFunction)structint_loads_many, METH_O, PyDoc_STR(LOADS_MANY_DOCSTR)},
+  {"_restore", (PyCFunction)structint_restore, METH_VARARGS, PyDoc_STR(RESTORE_DOCSTR)},
   {NULL}
 };
 
-static PyTypeObject structint_Type = {
-  PyVarObject_HEAD_INIT(NULL, 0)
-  .tp_name = "structint.structint",
-  .tp_doc = PyDoc_STR(STRUCTINT_DOCSTR),
-  .tp_basicsize = sizeof(structint_t),
-  .tp_itemsize = 0,
-  .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-  .tp_new = structint_new,
-  .tp_init = (initproc)structint_init,
-  .tp_dealloc = (destructor)structint_dealloc,
-  .tp_members = structint_members,
-  .tp_methods = structint_methods,
+int structint_module_exec(PyObject *m);
+int structint_module_traverse(PyObject *m, visitproc visit, void *arg);
+int structint_module_clear(PyObject *m);
+void structint_module_free(void *m);
+
+static PyModuleDef_Slot structint_module_slots[] = {
+  {Py_mod_exec, structint_module_exec},
+#ifdef Py_mod_multiple_interpreters
+  {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#endif
+#ifdef Py_mod_gil
+  {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+  {0, NULL}
 };
 
 static struct PyModuleDef module_structint = {
   PyModuleDef_HEAD_INIT,
   .m_name = "structint",
   .m_doc = STRUCTINT_DOCSTR,
-  .m_size = -1,
+  .m_size = sizeof(structint_state),
+  .m_methods = structint_module_methods,
+  .m_slots = structint_module_slots,
+  .m_traverse = structint_module_traverse,
+  .m_clear = structint_module_clear,
+  .m_free = structint_module_free,
 };
 
 
-PyMODINIT_FUNC PyInit_structint(void);
\ No newline at end of file
+PyMODINIT_FUNC PyInit_structint(void);
@@ -15,18 +15,29 @@
  along with StructInt.  If not, see <http://www.gnu.org/licenses/>.
 """
 
+import os
+
 from setuptools import Extension, setup
 
 def main():
+  # STRUCTINT_STATS=1 builds performance counters, STRUCTINT_USDT=1 adds USDT probes to them
+  define_macros = []
+  if os.environ.get("STRUCTINT_STATS") == "1":
+    define_macros.append(("STRUCTINT_STATS", "1"))
+  if os.environ.get("STRUCTINT_USDT") == "1":
+    define_macros.append(("STRUCTINT_USDT", "1"))
+
   setup(
     name="structint",
     version="0.0.3",
     author="grasol",
+    python_requires=">=3.9",
 
     ext_modules=[
       Extension(
         name="structint",
-        sources=["src/structint.c", "src/core.c"]
+        sources=["src/structint.c", "src/core.c", "src/batch.c", "src/arena.c", "src/expr.c", "src/stats.c", "src/serial.c"],
+        define_macros=define_macros
         )
       ]
     )